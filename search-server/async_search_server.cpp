@@ -0,0 +1,89 @@
+#include "async_search_server.h"
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server)
+    : AsyncSearchServer(search_server, Options{}) {
+}
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, Options options)
+    : search_server_(search_server)
+    , options_(options) {
+    workers_.reserve(options_.thread_count);
+    for (size_t i = 0; i < options_.thread_count; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+AsyncSearchServer::~AsyncSearchServer() {
+    {
+        std::lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    has_tasks_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::future<SearchServer::TimedResult> AsyncSearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentStatus status,
+                                                                                Clock::time_point deadline) {
+    return FindTopDocumentsAsync<DocumentStatus>(std::move(raw_query), status, deadline);
+}
+
+std::future<SearchServer::TimedResult> AsyncSearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentStatus status) {
+    return FindTopDocumentsAsync(std::move(raw_query), status, Clock::now() + options_.default_timeout);
+}
+
+AsyncSearchServer::Stats AsyncSearchServer::GetStats() const {
+    Stats stats;
+    stats.accepted = accepted_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.expired_in_queue = expired_in_queue_.load(std::memory_order_relaxed);
+    stats.truncated = truncated_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::future<SearchServer::TimedResult> AsyncSearchServer::Submit(Task task) {
+    std::future<SearchServer::TimedResult> result = task.get_future();
+    {
+        std::lock_guard guard(mutex_);
+        if (tasks_.size() < options_.queue_capacity && !stopping_) {
+            tasks_.push_back(std::move(task));
+            accepted_.fetch_add(1, std::memory_order_relaxed);
+            has_tasks_.notify_one();
+            return result;
+        }
+    }
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    std::promise<SearchServer::TimedResult> rejected;
+    rejected.set_exception(std::make_exception_ptr(QueryRejected("Очередь запросов переполнена.")));
+    return rejected.get_future();
+}
+
+void AsyncSearchServer::WorkerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock lock(mutex_);
+            has_tasks_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return; // stopping_ и очередь разобрана
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task(); // исключения разбора запроса уходят в future
+    }
+}
+
+SearchServer::TimedResult AsyncSearchServer::ExpiredResult() {
+    expired_in_queue_.fetch_add(1, std::memory_order_relaxed);
+    SearchServer::TimedResult result;
+    result.truncated = true;
+    return result;
+}
+
+void AsyncSearchServer::CountResult(const SearchServer::TimedResult& result) {
+    if (result.truncated) {
+        truncated_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
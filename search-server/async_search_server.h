@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+// Запрос не принят: очередь AsyncSearchServer заполнена. Клиенту стоит повторить позже.
+class QueryRejected : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Асинхронный вход в SearchServer: запросы попадают в ограниченную очередь и выполняются пулом потоков
+// через FindTopDocumentsWithDeadline. При полной очереди запрос сразу отклоняется (future с QueryRejected),
+// а не копит ждущие потоки. Запрос, чей срок истёк ещё в очереди, не выполняется: результат пустой, truncated.
+// Сервер не должен меняться, пока есть невыполненные запросы.
+class AsyncSearchServer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        size_t thread_count {std::max(1u, std::thread::hardware_concurrency())};
+        size_t queue_capacity {1024};
+        Clock::duration default_timeout {std::chrono::milliseconds(100)};
+    };
+
+    struct Stats {
+        uint64_t accepted {0};
+        uint64_t rejected {0};
+        uint64_t expired_in_queue {0};
+        uint64_t truncated {0};
+    };
+
+    explicit AsyncSearchServer(const SearchServer& search_server);
+    AsyncSearchServer(const SearchServer& search_server, Options options);
+    ~AsyncSearchServer(); // выполняет уже принятые запросы и останавливает потоки
+
+    AsyncSearchServer(const AsyncSearchServer&) = delete;
+    AsyncSearchServer& operator=(const AsyncSearchServer&) = delete;
+
+    template <typename DocumentPredicate>
+    std::future<SearchServer::TimedResult> FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate,
+                                                                 Clock::time_point deadline);
+
+    std::future<SearchServer::TimedResult> FindTopDocumentsAsync(std::string raw_query, DocumentStatus status,
+                                                                 Clock::time_point deadline);
+
+    // срок — сейчас + default_timeout
+    std::future<SearchServer::TimedResult> FindTopDocumentsAsync(std::string raw_query,
+                                                                 DocumentStatus status = DocumentStatus::ACTUAL);
+
+    Stats GetStats() const;
+
+private:
+    using Task = std::packaged_task<SearchServer::TimedResult()>;
+
+    std::future<SearchServer::TimedResult> Submit(Task task);
+    void WorkerLoop();
+    SearchServer::TimedResult ExpiredResult();
+    void CountResult(const SearchServer::TimedResult& result);
+
+    const SearchServer& search_server_;
+    Options options_;
+
+    std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    std::deque<Task> tasks_;
+    bool stopping_ {false};
+
+    std::atomic<uint64_t> accepted_ {0};
+    std::atomic<uint64_t> rejected_ {0};
+    std::atomic<uint64_t> expired_in_queue_ {0};
+    std::atomic<uint64_t> truncated_ {0};
+
+    std::vector<std::thread> workers_; // последним: потоки стартуют после остальных полей
+};
+
+template <typename DocumentPredicate>
+std::future<SearchServer::TimedResult> AsyncSearchServer::FindTopDocumentsAsync(std::string raw_query,
+                                                                                DocumentPredicate document_predicate,
+                                                                                Clock::time_point deadline) {
+    return Submit(Task([this, raw_query = std::move(raw_query), document_predicate, deadline] {
+        if (Clock::now() >= deadline) {
+            return ExpiredResult();
+        }
+        SearchServer::TimedResult result = search_server_.FindTopDocumentsWithDeadline(raw_query, document_predicate, deadline);
+        CountResult(result);
+        return result;
+    }));
+}
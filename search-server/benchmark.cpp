@@ -0,0 +1,157 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std::literals;
+
+namespace {
+
+// Значение поля "key": число или строка без кавычек внутри; отсутствующее поле — ошибка формата
+std::string_view FindJsonField(std::string_view line, std::string_view key) {
+    const std::string pattern = "\""s + std::string(key) + "\": "s;
+    const size_t pos = line.find(pattern);
+    if (pos == std::string_view::npos) {
+        throw std::runtime_error("В результатах замера нет поля "s + std::string(key));
+    }
+    std::string_view value = line.substr(pos + pattern.size());
+    if (!value.empty() && value.front() == '"') {
+        value.remove_prefix(1);
+        return value.substr(0, value.find('"'));
+    }
+    return value.substr(0, value.find_first_of(",}"sv));
+}
+
+double ReadJsonNumber(std::string_view line, std::string_view key) {
+    return std::stod(std::string(FindJsonField(line, key)));
+}
+
+} // namespace
+
+BenchmarkStats ComputeBenchmarkStats(std::vector<double> samples) {
+    BenchmarkStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t size = samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = size % 2 == 1 ? samples[size / 2] : (samples[size / 2 - 1] + samples[size / 2]) / 2;
+    stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / size;
+    if (size > 1) {
+        double squares = 0.0;
+        for (const double sample : samples) {
+            squares += (sample - stats.mean) * (sample - stats.mean);
+        }
+        stats.stddev = std::sqrt(squares / (size - 1));
+    }
+    return stats;
+}
+
+void BenchmarkSuite::Add(std::string name, size_t items, Body body, size_t threads) {
+    if (name.find_first_of("\"\\"sv) != std::string::npos) {
+        throw std::invalid_argument("Имя замера не может содержать кавычки и обратную косую черту"s);
+    }
+    cases_.push_back({std::move(name), std::max<size_t>(1, items), std::move(body), std::max<size_t>(1, threads)});
+}
+
+std::vector<BenchmarkResult> BenchmarkSuite::Run(size_t repetitions, std::string_view filter,
+                                                 std::ostream* progress) const {
+    std::vector<BenchmarkResult> results;
+    for (const Case& benchmark : cases_) {
+        if (benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        BenchmarkTimer timer;
+        benchmark.body(timer);
+        std::vector<double> samples;
+        samples.reserve(repetitions);
+        for (size_t i = 0; i < repetitions; ++i) {
+            benchmark.body(timer);
+            samples.push_back(timer.GetSeconds());
+        }
+        BenchmarkResult& result = results.emplace_back();
+        result.name = benchmark.name;
+        result.items = benchmark.items;
+        result.repetitions = repetitions;
+        result.stats = ComputeBenchmarkStats(std::move(samples));
+        result.threads = benchmark.threads;
+        if (progress) {
+            *progress << std::left << std::setw(48) << result.name << std::right
+                      << " median "sv << std::setw(10) << std::fixed << std::setprecision(3) << result.stats.median * 1e3
+                      << " ms, stddev "sv << std::setw(8) << result.stats.stddev * 1e3
+                      << " ms, "sv << std::setw(10) << std::setprecision(1) << result.GetNanosecondsPerItem()
+                      << " ns/item, "sv << std::setw(12) << std::setprecision(0) << result.GetItemsPerSecondPerThread()
+                      << " items/s/thread ("sv << result.threads << ')' << std::defaultfloat << std::endl;
+        }
+    }
+    return results;
+}
+
+void WriteBenchmarkJson(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    const auto precision = out.precision(9);
+    out << "{\"benchmarks\": [\n"sv;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        out << "  {\"name\": \""sv << result.name << "\", \"items\": "sv << result.items
+            << ", \"threads\": "sv << result.threads << ", \"repetitions\": "sv << result.repetitions
+            << ", \"min_s\": "sv << result.stats.min << ", \"median_s\": "sv << result.stats.median
+            << ", \"mean_s\": "sv << result.stats.mean << ", \"stddev_s\": "sv << result.stats.stddev
+            << ", \"max_s\": "sv << result.stats.max << ", \"ns_per_item\": "sv << result.GetNanosecondsPerItem()
+            << ", \"items_per_s_per_thread\": "sv << result.GetItemsPerSecondPerThread()
+            << '}' << (i + 1 < results.size() ? ",\n"sv : "\n"sv);
+    }
+    out << "]}"sv << std::endl;
+    out.precision(precision);
+}
+
+std::vector<BenchmarkResult> ReadBenchmarkJson(std::istream& in) {
+    std::vector<BenchmarkResult> results;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find("\"name\": "sv) == std::string::npos) {
+            continue;
+        }
+        BenchmarkResult& result = results.emplace_back();
+        result.name = FindJsonField(line, "name"sv);
+        result.items = static_cast<size_t>(ReadJsonNumber(line, "items"sv));
+        result.repetitions = static_cast<size_t>(ReadJsonNumber(line, "repetitions"sv));
+        result.stats.min = ReadJsonNumber(line, "min_s"sv);
+        result.stats.median = ReadJsonNumber(line, "median_s"sv);
+        result.stats.mean = ReadJsonNumber(line, "mean_s"sv);
+        result.stats.stddev = ReadJsonNumber(line, "stddev_s"sv);
+        result.stats.max = ReadJsonNumber(line, "max_s"sv);
+        // в прогонах, сохранённых до появления поля, все замеры считаются однопоточными
+        if (line.find("\"threads\": "sv) != std::string::npos) {
+            result.threads = static_cast<size_t>(ReadJsonNumber(line, "threads"sv));
+        }
+    }
+    return results;
+}
+
+size_t CompareBenchmarks(std::ostream& out, const std::vector<BenchmarkResult>& results,
+                         const std::vector<BenchmarkResult>& baseline, double threshold) {
+    size_t regressions = 0;
+    for (const BenchmarkResult& result : results) {
+        const auto base = std::find_if(baseline.begin(), baseline.end(), [&result](const BenchmarkResult& candidate) {
+            return candidate.name == result.name;
+        });
+        out << std::left << std::setw(48) << result.name << std::right;
+        if (base == baseline.end() || base->stats.median <= 0.0) {
+            out << " нет в базе"sv << std::endl;
+            continue;
+        }
+        const double change = result.stats.median / base->stats.median - 1.0;
+        const bool regressed = change > threshold;
+        regressions += regressed;
+        out << std::fixed << std::setprecision(3) << std::setw(10) << base->stats.median * 1e3 << " ms -> "sv
+            << std::setw(10) << result.stats.median * 1e3 << " ms "sv << std::showpos << std::setprecision(1)
+            << std::setw(7) << change * 100 << '%' << std::noshowpos << std::defaultfloat
+            << (regressed ? " ЗАМЕДЛЕНИЕ"sv : ""sv) << std::endl;
+    }
+    return regressions;
+}
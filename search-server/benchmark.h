@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Сводка по повторам одного замера, в секундах на повтор
+struct BenchmarkStats {
+    double min {0.0};
+    double median {0.0};
+    double mean {0.0};
+    double stddev {0.0};
+    double max {0.0};
+};
+
+BenchmarkStats ComputeBenchmarkStats(std::vector<double> samples);
+
+struct BenchmarkResult {
+    std::string name;
+    size_t items {1}; // операций за повтор: для пересчёта в наносекунды на операцию
+    size_t repetitions {0};
+    BenchmarkStats stats;
+    size_t threads {1}; // потоков, на которых шёл замер
+
+    double GetNanosecondsPerItem() const {
+        return stats.median * 1e9 / items;
+    }
+
+    // пропускная способность на поток: параллельный замер сравнивается с однопоточным по работе одного ядра
+    double GetItemsPerSecondPerThread() const {
+        return stats.median > 0.0 ? items / stats.median / threads : 0.0;
+    }
+};
+
+// Не даёт компилятору выбросить вычисление, результат которого не используется
+template <typename T>
+void DoNotOptimize(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Тело замера готовит данные как угодно, но время считается только внутри Measure.
+// Measure вызывается ровно один раз за повтор.
+class BenchmarkTimer {
+public:
+    template <typename Function>
+    void Measure(Function&& function) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        seconds_ = std::chrono::steady_clock::now() - start;
+    }
+
+    double GetSeconds() const {
+        return seconds_.count();
+    }
+
+private:
+    std::chrono::duration<double> seconds_ {0};
+};
+
+// Именованные замеры. Имя содержит параметры ("FindTopDocuments/par/queries=1000"),
+// чтобы результаты разных настроек не сравнивались между собой.
+class BenchmarkSuite {
+public:
+    using Body = std::function<void(BenchmarkTimer&)>;
+
+    // threads — сколько потоков занимает тело (для параллельных политик — число ядер)
+    void Add(std::string name, size_t items, Body body, size_t threads = 1);
+
+    // Каждый замер выполняется один раз вхолостую и repetitions раз с учётом времени.
+    // filter — подстрока имени, пустой — все замеры. progress, если задан, получает строку на замер.
+    std::vector<BenchmarkResult> Run(size_t repetitions, std::string_view filter = {},
+                                     std::ostream* progress = nullptr) const;
+
+private:
+    struct Case {
+        std::string name;
+        size_t items;
+        Body body;
+        size_t threads;
+    };
+
+    std::vector<Case> cases_;
+};
+
+// Одна строка JSON на замер: ReadBenchmarkJson читает ровно этот формат, чтобы сохранённый прогон служил базой
+void WriteBenchmarkJson(std::ostream& out, const std::vector<BenchmarkResult>& results);
+std::vector<BenchmarkResult> ReadBenchmarkJson(std::istream& in);
+
+// Сравнивает медианы с базой и печатает таблицу. Возвращает число замедлений больше threshold (0.1 — 10%).
+size_t CompareBenchmarks(std::ostream& out, const std::vector<BenchmarkResult>& results,
+                         const std::vector<BenchmarkResult>& baseline, double threshold);
@@ -0,0 +1,38 @@
+TEMPLATE = app
+TARGET = benchmark
+CONFIG += console c++20
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+        benchmark.cpp \
+        benchmark_main.cpp \
+        document.cpp \
+        document_filter.cpp \
+        process_queries.cpp \
+        scratch_arena.cpp \
+        search_server.cpp \
+        string_processing.cpp \
+        synthetic_data.cpp \
+        trace.cpp
+
+HEADERS += \
+    benchmark.h \
+    concurrent_map.h \
+    document.h \
+    document_filter.h \
+    execution_mode.h \
+    interleaved_task.h \
+    intersection.h \
+    memory_accounting.h \
+    plan_cache.h \
+    process_queries.h \
+    query_stats.h \
+    scratch_arena.h \
+    search_server.h \
+    string_processing.h \
+    synthetic_data.h \
+    trace.h
+
+LIBS += -ltbb \
+        -lpthread
@@ -0,0 +1,271 @@
+// Набор замеров производительности на синтетических данных из фиксированного seed.
+//
+//   benchmark [--documents 10000] [--document-words 70] [--dictionary 1000] [--queries 1000] [--query-words 7]
+//             [--seed 42] [--repetitions 5] [--filter FindTop] [--json results.json]
+//             [--baseline baseline.json] [--threshold 0.1]
+//
+// С --baseline печатает сравнение медиан и завершается с ошибкой, если что-то замедлилось больше threshold.
+
+#include "benchmark.h"
+#include "concurrent_map.h"
+#include "process_queries.h"
+#include "search_server.h"
+#include "string_processing.h"
+#include "synthetic_data.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <execution>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct BenchmarkOptions {
+    size_t document_count {10'000};
+    int document_words {70};
+    int dictionary_size {1'000};
+    size_t query_count {1'000};
+    int query_words {7};
+    uint64_t seed {42};
+};
+
+// Данные и заполненный сервер общие для всех замеров; изменяющие замеры строят свои копии вне Measure
+struct Dataset {
+    vector<string> dictionary;
+    vector<string> texts;
+    vector<SearchServer::DocumentSource> documents;
+    vector<string> queries;
+    string long_query; // для MatchDocument: много слов и минус-слова
+    SearchServer search_server;
+
+    explicit Dataset(const BenchmarkOptions& options) {
+        mt19937_64 generator(options.seed);
+        dictionary = GenerateDictionary(generator, options.dictionary_size, 10);
+        texts = GenerateTexts(generator, dictionary, options.document_count, options.document_words);
+        documents.resize(texts.size());
+        for (size_t i = 0; i < texts.size(); ++i) {
+            documents[i] = {static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1, 2, 3}};
+        }
+        queries = GenerateQueries(generator, dictionary, options.query_count, options.query_words);
+        long_query = GenerateQuery(generator, dictionary, 500, 0.1);
+        search_server = SearchServer(dictionary[0]);
+        search_server.AddDocuments(execution::par, documents);
+    }
+
+    SearchServer MakeServer() const {
+        SearchServer server(dictionary[0]);
+        server.AddDocuments(execution::par, documents);
+        return server;
+    }
+};
+
+// потоков, которые занимает замер с политикой: параллельные алгоритмы берут все ядра
+template <typename ExecutionPolicy>
+size_t GetThreadCount(ExecutionPolicy) {
+    if constexpr (is_same_v<ExecutionPolicy, execution::sequenced_policy>) {
+        return 1;
+    } else {
+        return max<size_t>(1, thread::hardware_concurrency());
+    }
+}
+
+template <typename ExecutionPolicy>
+void AddRemoveBenchmark(BenchmarkSuite& suite, const Dataset& data, string_view mark, ExecutionPolicy policy) {
+    suite.Add("RemoveDocument/"s + string(mark) + "/docs="s + to_string(data.documents.size()), data.documents.size(),
+              [&data, policy](BenchmarkTimer& timer) {
+        SearchServer server = data.MakeServer();
+        timer.Measure([&] {
+            for (const auto& document : data.documents) {
+                server.RemoveDocument(policy, document.id);
+            }
+        });
+        DoNotOptimize(server.GetDocumentCount());
+    }, GetThreadCount(policy));
+}
+
+template <typename ExecutionPolicy>
+void AddFindBenchmark(BenchmarkSuite& suite, const Dataset& data, string_view mark, ExecutionPolicy policy) {
+    suite.Add("FindTopDocuments/"s + string(mark) + "/queries="s + to_string(data.queries.size()), data.queries.size(),
+              [&data, policy](BenchmarkTimer& timer) {
+        timer.Measure([&] {
+            for (const string& query : data.queries) {
+                DoNotOptimize(data.search_server.FindTopDocuments(policy, query));
+            }
+        });
+    }, GetThreadCount(policy));
+}
+
+template <typename ExecutionPolicy>
+void AddMatchBenchmark(BenchmarkSuite& suite, const Dataset& data, string_view mark, ExecutionPolicy policy) {
+    suite.Add("MatchDocument/"s + string(mark) + "/docs="s + to_string(data.documents.size()), data.documents.size(),
+              [&data, policy](BenchmarkTimer& timer) {
+        timer.Measure([&] {
+            for (const auto& document : data.documents) {
+                DoNotOptimize(data.search_server.MatchDocument(policy, data.long_query, document.id));
+            }
+        });
+    }, GetThreadCount(policy));
+}
+
+void RegisterBenchmarks(BenchmarkSuite& suite, const Dataset& data) {
+    const string docs = "/docs="s + to_string(data.documents.size());
+    const string queries = "/queries="s + to_string(data.queries.size());
+    const size_t cores = GetThreadCount(execution::par);
+
+    suite.Add("AddDocument"s + docs, data.documents.size(), [&data](BenchmarkTimer& timer) {
+        SearchServer server(data.dictionary[0]);
+        timer.Measure([&] {
+            for (const auto& document : data.documents) {
+                server.AddDocument(document.id, document.text, document.status, document.ratings);
+            }
+        });
+        DoNotOptimize(server.GetDocumentCount());
+    });
+    suite.Add("AddDocuments/seq"s + docs, data.documents.size(), [&data](BenchmarkTimer& timer) {
+        SearchServer server(data.dictionary[0]);
+        timer.Measure([&] {
+            server.AddDocuments(execution::seq, data.documents);
+        });
+        DoNotOptimize(server.GetDocumentCount());
+    });
+    suite.Add("AddDocuments/par"s + docs, data.documents.size(), [&data](BenchmarkTimer& timer) {
+        SearchServer server(data.dictionary[0]);
+        timer.Measure([&] {
+            server.AddDocuments(execution::par, data.documents);
+        });
+        DoNotOptimize(server.GetDocumentCount());
+    }, cores);
+
+    AddRemoveBenchmark(suite, data, "seq"sv, execution::seq);
+    AddRemoveBenchmark(suite, data, "par"sv, execution::par);
+    AddFindBenchmark(suite, data, "seq"sv, execution::seq);
+    AddFindBenchmark(suite, data, "par"sv, execution::par);
+    AddMatchBenchmark(suite, data, "seq"sv, execution::seq);
+    AddMatchBenchmark(suite, data, "par"sv, execution::par);
+
+    suite.Add("ProcessQueries"s + queries, data.queries.size(), [&data](BenchmarkTimer& timer) {
+        timer.Measure([&] {
+            DoNotOptimize(ProcessQueries(data.search_server, data.queries));
+        });
+    }, cores);
+    suite.Add("ProcessQueriesJoined"s + queries, data.queries.size(), [&data](BenchmarkTimer& timer) {
+        timer.Measure([&] {
+            DoNotOptimize(ProcessQueriesJoined(data.search_server, data.queries));
+        });
+    }, cores);
+
+    // Чередование корутин: один поток и пакет запросов на все ядра. Сравнивать по items/s/thread:
+    // однопоточный — с FindTopDocuments/seq, параллельный — с ProcessQueries при том же числе потоков
+    suite.Add("FindTopDocumentsInterleaved"s + queries, data.queries.size(), [&data](BenchmarkTimer& timer) {
+        timer.Measure([&] {
+            DoNotOptimize(data.search_server.FindTopDocumentsInterleaved(data.queries));
+        });
+    });
+    suite.Add("ProcessQueriesInterleaved"s + queries, data.queries.size(), [&data](BenchmarkTimer& timer) {
+        timer.Measure([&] {
+            DoNotOptimize(ProcessQueriesInterleaved(data.search_server, data.queries));
+        });
+    }, cores);
+
+    suite.Add("SplitIntoWords"s + docs, data.texts.size(), [&data](BenchmarkTimer& timer) {
+        timer.Measure([&] {
+            for (const string& text : data.texts) {
+                DoNotOptimize(SplitIntoWords(text));
+            }
+        });
+    });
+
+    // Параллельные приращения по всем словам документов: ключ — номер слова в словаре
+    constexpr size_t BUCKET_COUNT = 100;
+    vector<int> word_ids;
+    for (const string& text : data.texts) {
+        for (const string_view word : SplitIntoWords(text)) {
+            word_ids.push_back(static_cast<int>(lower_bound(data.dictionary.begin(), data.dictionary.end(), word)
+                                                - data.dictionary.begin()));
+        }
+    }
+    const size_t increment_count = word_ids.size();
+    suite.Add("ConcurrentMap/par/buckets="s + to_string(BUCKET_COUNT) + "/increments="s + to_string(increment_count),
+              increment_count, [word_ids = move(word_ids)](BenchmarkTimer& timer) {
+        ConcurrentMap<int, int> counts(BUCKET_COUNT);
+        timer.Measure([&] {
+            for_each(execution::par, word_ids.begin(), word_ids.end(), [&counts](int word_id) {
+                ++counts[word_id].ref_to_value;
+            });
+        });
+        DoNotOptimize(counts.BuildOrdinaryMap());
+    }, cores);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    size_t repetitions = 5;
+    string filter;
+    string json_path;
+    string baseline_path;
+    double threshold = 0.1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const string_view name = argv[i];
+        const string value = argv[i + 1];
+        if (name == "--documents"sv) {
+            options.document_count = stoul(value);
+        } else if (name == "--document-words"sv) {
+            options.document_words = stoi(value);
+        } else if (name == "--dictionary"sv) {
+            options.dictionary_size = stoi(value);
+        } else if (name == "--queries"sv) {
+            options.query_count = stoul(value);
+        } else if (name == "--query-words"sv) {
+            options.query_words = stoi(value);
+        } else if (name == "--seed"sv) {
+            options.seed = stoull(value);
+        } else if (name == "--repetitions"sv) {
+            repetitions = stoul(value);
+        } else if (name == "--filter"sv) {
+            filter = value;
+        } else if (name == "--json"sv) {
+            json_path = value;
+        } else if (name == "--baseline"sv) {
+            baseline_path = value;
+        } else if (name == "--threshold"sv) {
+            threshold = stod(value);
+        } else {
+            cerr << "Неизвестный параметр "sv << name << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const Dataset data(options);
+    BenchmarkSuite suite;
+    RegisterBenchmarks(suite, data);
+    const vector<BenchmarkResult> results = suite.Run(repetitions, filter, &cout);
+
+    if (!json_path.empty()) {
+        ofstream out(json_path);
+        WriteBenchmarkJson(out, results);
+    }
+    if (!baseline_path.empty()) {
+        ifstream in(baseline_path);
+        if (!in) {
+            cerr << "Не удалось открыть "sv << baseline_path << endl;
+            return EXIT_FAILURE;
+        }
+        cout << endl;
+        if (CompareBenchmarks(cout, results, ReadBenchmarkJson(in), threshold) > 0) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Двоичный формат журнала и снимков: целые — в порядке байтов платформы, строки — длина (uint32) и байты.
+// Файлы переносятся только между машинами с одинаковым порядком байтов.
+
+template <typename T>
+void WriteBinary(std::string& out, T value) {
+    static_assert(std::is_trivially_copyable_v<T>, "WriteBinary supports only trivially copyable types");
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void WriteBinary(std::string& out, std::string_view text) {
+    WriteBinary(out, static_cast<uint32_t>(text.size()));
+    out.append(text);
+}
+
+// Чтение по буферу; при выходе за его границу бросает std::runtime_error
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data)
+        : data_(data) {
+    }
+
+    template <typename T>
+    T Read() {
+        static_assert(std::is_trivially_copyable_v<T>, "BinaryReader supports only trivially copyable types");
+        Require(sizeof(T));
+        T value;
+        std::memcpy(&value, data_.data() + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return value;
+    }
+
+    std::string_view ReadString() {
+        const uint32_t size = Read<uint32_t>();
+        Require(size);
+        const std::string_view text = data_.substr(offset_, size);
+        offset_ += size;
+        return text;
+    }
+
+    bool AtEnd() const {
+        return offset_ == data_.size();
+    }
+
+    size_t GetOffset() const {
+        return offset_;
+    }
+
+private:
+    void Require(size_t size) const {
+        if (data_.size() - offset_ < size) {
+            throw std::runtime_error("Неожиданный конец двоичных данных.");
+        }
+    }
+
+    std::string_view data_;
+    size_t offset_ {0};
+};
+
+// CRC-32 (IEEE 802.3), табличный
+inline uint32_t Crc32(std::string_view data, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> result {};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+            }
+            result[i] = value;
+        }
+        return result;
+    }();
+    crc = ~crc;
+    for (const char c : data) {
+        crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFFu] ^ (crc >> 8);
+    }
+    return ~crc;
+}
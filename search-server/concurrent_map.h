@@ -3,6 +3,7 @@
 #include <iostream>
 #include <mutex>
 #include <map>
+#include <memory_resource>
 #include <vector>
 #include <execution>
 #include <future>
@@ -15,16 +16,30 @@
 template <typename Key, typename Value>
 class ConcurrentMap {
 private:
+    // Узлы словаря сегмента сначала занимают встроенный буфер, затем — собственные блоки сегмента,
+    // поэтому вставки в разные сегменты из разных потоков не соревнуются за общий аллокатор.
+    static constexpr size_t BUCKET_BUFFER_SIZE {256};
+
     struct Bucket {
         std::mutex mutex;
-        std::map<Key, Value> map;
+        alignas(std::max_align_t) std::byte buffer[BUCKET_BUFFER_SIZE];
+        std::pmr::monotonic_buffer_resource nodes {buffer, BUCKET_BUFFER_SIZE, std::pmr::get_default_resource()};
+        std::pmr::map<Key, Value> map {&nodes};
     };
 
     size_t getBucketId(const Key& key) const {
         return static_cast<uint64_t>(key) % buckets_.size();
     }
 
-    std::vector<Bucket> buckets_;
+    std::pmr::vector<Bucket> buckets_;
+
+    template <typename Map>
+    void MergeInto(Map& result) {
+        for (auto& bucket : buckets_) {
+            std::lock_guard g(bucket.mutex);
+            result.insert(bucket.map.begin(), bucket.map.end());
+        }
+    }
 
 public:
     static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys"); //s
@@ -42,8 +57,9 @@ public:
 
     //Конструктор класса ConcurrentMap<Key, Value>
     //принимает количество подсловарей, на которые надо разбить всё пространство ключей.
-    explicit ConcurrentMap(size_t bucket_count)
-        : buckets_(bucket_count) {
+    //Сами сегменты (вместе с их начальными буферами) размещаются в resource, который нужен только потоку-владельцу.
+    explicit ConcurrentMap(size_t bucket_count, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : buckets_(bucket_count, resource) {
     }
 
     //operator[] должен вести себя так же, как аналогичный оператор у map:
@@ -66,10 +82,13 @@ public:
     //то есть корректно работать, когда другие потоки выполняют операции с ConcurrentMap
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> result;
-        for (auto& [mutex, map] : buckets_) {
-            std::lock_guard g(mutex);
-            result.insert(map.begin(), map.end());
-        }
+        MergeInto(result);
+        return result;
+    }
+
+    std::pmr::map<Key, Value> BuildOrdinaryMap(std::pmr::memory_resource* resource) {
+        std::pmr::map<Key, Value> result(resource);
+        MergeInto(result);
         return result;
     }
 };
@@ -1,4 +1,9 @@
 #include "document.h"
+
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
 
 std::ostream& operator<<(std::ostream& out, const Document& document) {
@@ -10,3 +15,45 @@ std::ostream& operator<<(std::ostream& out, const Document& document) {
         << "rating = "s << document.rating << " }"s;
     return out;
 }
+
+// токен: биты релевантности в hex, рейтинг и id через ':'; пустой — начало выдачи
+std::string SearchCursor::ToString() const {
+    if (!last_) {
+        return {};
+    }
+    std::string token;
+    const auto append = [&token](auto value, int base) {
+        char buffer[24];
+        token.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value, base).ptr);
+    };
+    append(std::bit_cast<uint64_t>(last_->relevance), 16);
+    token += ':';
+    append(last_->rating, 10);
+    token += ':';
+    append(last_->id, 10);
+    return token;
+}
+
+SearchCursor SearchCursor::Parse(std::string_view token) {
+    if (token.empty()) {
+        return SearchCursor();
+    }
+    const char* pos = token.data();
+    const char* const last = token.data() + token.size();
+    // поле и следующий за ним разделитель (у последнего поля — конец токена)
+    const auto parse_field = [&pos, last](auto& value, char delimiter, int base) {
+        const auto [end, error] = std::from_chars(pos, last, value, base);
+        const bool delimited = delimiter == '\0' ? end == last : end != last && *end == delimiter;
+        if (error != std::errc() || !delimited) {
+            throw std::invalid_argument("Неверный токен курсора.");
+        }
+        pos = end + 1;
+    };
+    uint64_t relevance_bits = 0;
+    Document document;
+    parse_field(relevance_bits, ':', 16);
+    parse_field(document.rating, ':', 10);
+    parse_field(document.id, '\0', 10);
+    document.relevance = std::bit_cast<double>(relevance_bits);
+    return SearchCursor(document);
+}
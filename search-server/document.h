@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cmath>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
 
 enum class DocumentStatus {
     ACTUAL,
@@ -24,3 +28,42 @@ struct Document {
 
 std::ostream& operator<<(std::ostream& out, const Document& document);
 
+
+// Порядок выдачи: по убыванию релевантности (с точностью до 1e-6), затем рейтинга, затем по возрастанию id.
+// id делает порядок полным, чтобы страницы курсора не теряли и не повторяли документы с равным рангом.
+inline bool IsRankedBefore(const Document& lhs, const Document& rhs) {
+    const double EPSILON = 1e-6;
+    if (std::abs(lhs.relevance - rhs.relevance) >= EPSILON) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+// Позиция в ранжированной выдаче для постраничного обхода (search-after):
+// следующая страница начинается строго после последнего документа предыдущей.
+// Для клиента токен непрозрачен: ToString/Parse переносят его между запросами без потери точности.
+class SearchCursor {
+public:
+    SearchCursor() = default; // начало выдачи
+    explicit SearchCursor(const Document& last_document)
+        : last_(last_document) {
+    }
+
+    bool IsStart() const {
+        return !last_.has_value();
+    }
+
+    // документ стоит в выдаче после позиции курсора
+    bool Precedes(const Document& document) const {
+        return !last_ || IsRankedBefore(*last_, document);
+    }
+
+    std::string ToString() const;
+    static SearchCursor Parse(std::string_view token); // std::invalid_argument при неверном токене
+
+private:
+    std::optional<Document> last_;
+};
@@ -0,0 +1,76 @@
+#include "document_filter.h"
+
+#include <algorithm>
+
+DocumentFilter DocumentFilter::StatusIn(std::vector<DocumentStatus> statuses) {
+    std::sort(statuses.begin(), statuses.end());
+    statuses.erase(std::unique(statuses.begin(), statuses.end()), statuses.end());
+
+    Node node;
+    node.kind = Kind::STATUS_IN;
+    node.statuses = std::move(statuses);
+    return DocumentFilter(std::make_shared<const Node>(std::move(node)));
+}
+
+DocumentFilter DocumentFilter::RatingBetween(int min_rating, int max_rating) {
+    Node node;
+    node.kind = Kind::RATING_BETWEEN;
+    node.min_rating = min_rating;
+    node.max_rating = max_rating;
+    return DocumentFilter(std::make_shared<const Node>(std::move(node)));
+}
+
+DocumentFilter DocumentFilter::IdIn(std::vector<int> document_ids) {
+    std::sort(document_ids.begin(), document_ids.end());
+    document_ids.erase(std::unique(document_ids.begin(), document_ids.end()), document_ids.end());
+
+    Node node;
+    node.kind = Kind::ID_IN;
+    node.document_ids = std::move(document_ids);
+    return DocumentFilter(std::make_shared<const Node>(std::move(node)));
+}
+
+DocumentFilter operator&&(DocumentFilter lhs, DocumentFilter rhs) {
+    DocumentFilter::Node node;
+    node.kind = DocumentFilter::Kind::AND;
+    node.lhs = std::move(lhs.root_);
+    node.rhs = std::move(rhs.root_);
+    return DocumentFilter(std::make_shared<const DocumentFilter::Node>(std::move(node)));
+}
+
+DocumentFilter operator||(DocumentFilter lhs, DocumentFilter rhs) {
+    DocumentFilter::Node node;
+    node.kind = DocumentFilter::Kind::OR;
+    node.lhs = std::move(lhs.root_);
+    node.rhs = std::move(rhs.root_);
+    return DocumentFilter(std::make_shared<const DocumentFilter::Node>(std::move(node)));
+}
+
+DocumentFilter operator!(DocumentFilter filter) {
+    DocumentFilter::Node node;
+    node.kind = DocumentFilter::Kind::NOT;
+    node.lhs = std::move(filter.root_);
+    return DocumentFilter(std::make_shared<const DocumentFilter::Node>(std::move(node)));
+}
+
+bool DocumentFilter::operator()(int document_id, DocumentStatus status, int rating) const {
+    return Evaluate(*root_, document_id, status, rating);
+}
+
+bool DocumentFilter::Evaluate(const Node& node, int document_id, DocumentStatus status, int rating) {
+    switch (node.kind) {
+    case Kind::STATUS_IN:
+        return std::binary_search(node.statuses.begin(), node.statuses.end(), status);
+    case Kind::RATING_BETWEEN:
+        return node.min_rating <= rating && rating <= node.max_rating;
+    case Kind::ID_IN:
+        return std::binary_search(node.document_ids.begin(), node.document_ids.end(), document_id);
+    case Kind::AND:
+        return Evaluate(*node.lhs, document_id, status, rating) && Evaluate(*node.rhs, document_id, status, rating);
+    case Kind::OR:
+        return Evaluate(*node.lhs, document_id, status, rating) || Evaluate(*node.rhs, document_id, status, rating);
+    case Kind::NOT:
+        return !Evaluate(*node.lhs, document_id, status, rating);
+    }
+    return false;
+}
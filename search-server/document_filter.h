@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "document.h"
+
+// Декларативный фильтр документов: статус из набора, рейтинг в диапазоне, id из набора
+// и их комбинации через &&, || и !.
+// В отличие от произвольного предиката, SearchServer видит структуру такого фильтра:
+// обходит только сегменты допустимых статусов, а явные id и узкий диапазон рейтингов пересекает со списками.
+//
+//  const auto filter = DocumentFilter::StatusIn({DocumentStatus::ACTUAL})
+//                      && DocumentFilter::RatingBetween(3, 10)
+//                      && !DocumentFilter::IdIn({4, 8});
+//  search_server.FindTopDocuments("curly cat"s, filter);
+class DocumentFilter {
+public:
+    static DocumentFilter StatusIn(std::vector<DocumentStatus> statuses);
+    static DocumentFilter RatingBetween(int min_rating, int max_rating); // границы включаются
+    static DocumentFilter IdIn(std::vector<int> document_ids);
+
+    friend DocumentFilter operator&&(DocumentFilter lhs, DocumentFilter rhs);
+    friend DocumentFilter operator||(DocumentFilter lhs, DocumentFilter rhs);
+    friend DocumentFilter operator!(DocumentFilter filter);
+
+    // проверка одного документа — фильтр можно передавать везде, где ожидается предикат
+    bool operator()(int document_id, DocumentStatus status, int rating) const;
+
+private:
+    friend class SearchServer;
+
+    enum class Kind {
+        STATUS_IN,
+        RATING_BETWEEN,
+        ID_IN,
+        AND,
+        OR,
+        NOT,
+    };
+
+    struct Node {
+        Kind kind {Kind::STATUS_IN};
+        std::vector<DocumentStatus> statuses;   // STATUS_IN, отсортированы и без повторов
+        int min_rating {0};                     // RATING_BETWEEN
+        int max_rating {0};
+        std::vector<int> document_ids;          // ID_IN, отсортированы и без повторов
+        std::shared_ptr<const Node> lhs;        // AND, OR, NOT
+        std::shared_ptr<const Node> rhs;        // AND, OR
+    };
+
+    explicit DocumentFilter(std::shared_ptr<const Node> root)
+        : root_(std::move(root)) {}
+
+    static bool Evaluate(const Node& node, int document_id, DocumentStatus status, int rating);
+
+    std::shared_ptr<const Node> root_;
+};
@@ -0,0 +1,241 @@
+#include "durable_search_server.h"
+#include "binary_io.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t SNAPSHOT_MAGIC {0x504E5353}; // "SSNP"
+constexpr uint32_t SNAPSHOT_VERSION {1};
+
+void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void SyncPath(const std::string& path, int flags) {
+    const int fd = ::open(path.c_str(), flags | O_CLOEXEC);
+    if (fd < 0) {
+        ThrowSystemError("Не удалось открыть " + path);
+    }
+    const int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0) {
+        ThrowSystemError("Ошибка синхронизации " + path);
+    }
+}
+
+// запись во временный файл, fsync, rename поверх старого и fsync каталога:
+// после падения на диске либо старый файл целиком, либо новый
+void WriteFileAtomically(const std::string& path, std::string_view data) {
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out.flush()) {
+            throw std::runtime_error("Не удалось записать " + temp_path);
+        }
+    }
+    SyncPath(temp_path, O_RDONLY);
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        ThrowSystemError("Не удалось заменить " + path);
+    }
+    SyncPath(std::filesystem::path(path).parent_path().string(), O_RDONLY | O_DIRECTORY);
+}
+
+} // namespace
+
+DurableSearchServer::DurableSearchServer(const std::string& directory, std::string_view stop_words, WalOptions options)
+    : snapshot_path_((std::filesystem::path(directory) / "snapshot").string())
+    , wal_path_((std::filesystem::path(directory) / "wal").string())
+    , search_server_(LoadSnapshotFile(snapshot_path_, stop_words, snapshot_lsn_)) {
+    if (!std::filesystem::exists(snapshot_path_)) {
+        // стоп-слова сохраняются сразу, иначе журнал без снимка нельзя было бы воспроизвести
+        WriteSnapshot(snapshot_lsn_);
+    }
+    ReplayWal();
+    wal_ = std::make_unique<WriteAheadLog>(wal_path_, snapshot_lsn_ + replayed_records_ + 1, options);
+}
+
+void DurableSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    search_server_.AddDocument(document_id, document, status, ratings);
+    WalRecord record;
+    record.operation = WalOperation::ADD_DOCUMENT;
+    record.document_id = document_id;
+    record.status = status;
+    record.ratings = ratings;
+    record.text = document;
+    wal_->Append(std::move(record));
+}
+
+void DurableSearchServer::AddDocuments(const std::vector<SearchServer::DocumentSource>& documents) {
+    search_server_.AddDocuments(std::execution::par, documents);
+    for (const SearchServer::DocumentSource& document : documents) {
+        WalRecord record;
+        record.operation = WalOperation::ADD_DOCUMENT;
+        record.document_id = document.id;
+        record.status = document.status;
+        record.ratings = document.ratings;
+        record.text = document.text;
+        wal_->Append(std::move(record));
+    }
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    RemoveDocuments({document_id});
+}
+
+void DurableSearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    if (document_ids.empty()) {
+        return;
+    }
+    search_server_.RemoveDocuments(std::execution::par, document_ids);
+    WalRecord record;
+    record.operation = WalOperation::REMOVE_DOCUMENTS;
+    record.document_ids = document_ids;
+    wal_->Append(std::move(record));
+}
+
+void DurableSearchServer::UpdateDocument(int document_id, std::string_view document, DocumentStatus status,
+                                         const std::vector<int>& ratings) {
+    search_server_.UpdateDocument(document_id, document, status, ratings);
+    WalRecord record;
+    record.operation = WalOperation::UPDATE_DOCUMENT;
+    record.document_id = document_id;
+    record.status = status;
+    record.ratings = ratings;
+    record.text = document;
+    wal_->Append(std::move(record));
+}
+
+void DurableSearchServer::UpdateDocumentAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings) {
+    search_server_.UpdateDocumentAttributes(document_id, status, ratings);
+    WalRecord record;
+    record.operation = WalOperation::UPDATE_ATTRIBUTES;
+    record.document_id = document_id;
+    record.status = status;
+    record.ratings = ratings;
+    wal_->Append(std::move(record));
+}
+
+void DurableSearchServer::Commit() {
+    wal_->Commit();
+}
+
+void DurableSearchServer::Snapshot() {
+    const uint64_t lsn = wal_->GetLastLsn();
+    WriteSnapshot(lsn);
+    snapshot_lsn_ = lsn;
+    // если упадём до очистки журнала, его записи пропустятся при восстановлении по lsn
+    wal_->Reset();
+}
+
+const SearchServer& DurableSearchServer::GetSearchServer() const {
+    return search_server_;
+}
+
+size_t DurableSearchServer::GetReplayedRecordCount() const {
+    return replayed_records_;
+}
+
+SearchServer DurableSearchServer::LoadSnapshotFile(const std::string& path, std::string_view stop_words, uint64_t& lsn) {
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        lsn = 0;
+        return SearchServer(stop_words);
+    }
+    const std::string data {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    BinaryReader reader(data);
+    if (reader.Read<uint32_t>() != SNAPSHOT_MAGIC || reader.Read<uint32_t>() != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Неизвестный формат снимка " + path);
+    }
+    lsn = reader.Read<uint64_t>();
+    const uint32_t crc = reader.Read<uint32_t>();
+    const std::string_view body = std::string_view(data).substr(reader.GetOffset());
+    if (Crc32(body) != crc) {
+        throw std::runtime_error("Снимок повреждён: " + path);
+    }
+    return SearchServer::LoadSnapshot(body);
+}
+
+void DurableSearchServer::ReplayWal() {
+    std::vector<WalRecord> pending_adds;
+    std::vector<int> pending_removes;
+
+    const auto flush_adds = [&] {
+        if (pending_adds.empty()) {
+            return;
+        }
+        std::vector<SearchServer::DocumentSource> documents;
+        documents.reserve(pending_adds.size());
+        for (const WalRecord& record : pending_adds) {
+            documents.push_back({record.document_id, record.text, record.status, record.ratings});
+        }
+        search_server_.AddDocuments(std::execution::par, documents);
+        pending_adds.clear();
+    };
+    const auto flush_removes = [&] {
+        if (!pending_removes.empty()) {
+            search_server_.RemoveDocuments(std::execution::par, pending_removes);
+            pending_removes.clear();
+        }
+    };
+
+    const size_t valid_size = WriteAheadLog::Read(wal_path_, [&](const WalRecord& record) {
+        if (record.lsn <= snapshot_lsn_) {
+            return; // уже в снимке: упали между его записью и очисткой журнала
+        }
+        ++replayed_records_;
+        switch (record.operation) {
+        case WalOperation::ADD_DOCUMENT:
+            flush_removes();
+            pending_adds.push_back(record);
+            if (pending_adds.size() >= REPLAY_BATCH_SIZE) {
+                flush_adds();
+            }
+            break;
+        case WalOperation::REMOVE_DOCUMENTS:
+            flush_adds();
+            pending_removes.insert(pending_removes.end(), record.document_ids.begin(), record.document_ids.end());
+            break;
+        case WalOperation::UPDATE_DOCUMENT:
+            flush_adds();
+            flush_removes();
+            search_server_.UpdateDocument(record.document_id, record.text, record.status, record.ratings);
+            break;
+        case WalOperation::UPDATE_ATTRIBUTES:
+            flush_adds();
+            flush_removes();
+            search_server_.UpdateDocumentAttributes(record.document_id, record.status, record.ratings);
+            break;
+        }
+    });
+    flush_adds();
+    flush_removes();
+
+    // недописанный при падении хвост отрезается, чтобы новые записи шли сразу за корректными
+    if (std::filesystem::exists(wal_path_) && std::filesystem::file_size(wal_path_) != valid_size) {
+        std::filesystem::resize_file(wal_path_, valid_size);
+    }
+}
+
+void DurableSearchServer::WriteSnapshot(uint64_t lsn) const {
+    std::string body;
+    search_server_.SaveSnapshot(body);
+    std::string data;
+    WriteBinary(data, SNAPSHOT_MAGIC);
+    WriteBinary(data, SNAPSHOT_VERSION);
+    WriteBinary(data, lsn);
+    WriteBinary(data, Crc32(body));
+    data += body;
+    WriteFileAtomically(snapshot_path_, data);
+}
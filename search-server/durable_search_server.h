@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+// SearchServer, переживающий перезапуск: каждое изменение пишется в журнал (directory/wal),
+// периодический Snapshot сохраняет весь индекс (directory/snapshot) и очищает журнал.
+// При создании индекс восстанавливается из снимка и хвоста журнала; подряд идущие добавления
+// и удаления из журнала применяются пачками через AddDocuments/RemoveDocuments(par).
+// Изменение подтверждено (переживёт падение), когда после него выполнен Commit.
+class DurableSearchServer {
+public:
+    // stop_words используются, только если в directory ещё нет снимка
+    DurableSearchServer(const std::string& directory, std::string_view stop_words, WalOptions options = {});
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void AddDocuments(const std::vector<SearchServer::DocumentSource>& documents);
+    void RemoveDocument(int document_id);
+    void RemoveDocuments(const std::vector<int>& document_ids);
+    void UpdateDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void UpdateDocumentAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings);
+
+    void Commit();   // групповой коммит всех изменений после предыдущего
+    void Snapshot(); // атомарно заменяет снимок и очищает журнал
+
+    const SearchServer& GetSearchServer() const;
+    size_t GetReplayedRecordCount() const; // сколько записей журнала применено при восстановлении
+
+private:
+    static constexpr size_t REPLAY_BATCH_SIZE {8'192}; // ограничивает память под тексты пачки при восстановлении
+
+    // снимок из path или пустой сервер со stop_words, если снимка нет; lsn — последняя вошедшая в него запись
+    static SearchServer LoadSnapshotFile(const std::string& path, std::string_view stop_words, uint64_t& lsn);
+    void ReplayWal();
+    void WriteSnapshot(uint64_t lsn) const;
+
+    std::string snapshot_path_;
+    std::string wal_path_;
+    uint64_t snapshot_lsn_ {0}; // записи журнала с lsn не больше уже входят в снимок
+    SearchServer search_server_;
+    size_t replayed_records_ {0};
+    std::unique_ptr<WriteAheadLog> wal_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Адаптивный режим исполнения: сервер сам выбирает seq или par по оценке объёма работы запроса.
+// Используется как обычная политика: search_server.FindTopDocuments(adaptive_policy, query).
+struct AdaptivePolicy {};
+
+inline constexpr AdaptivePolicy adaptive_policy {};
+
+enum class ExecutionPath {
+    SEQUENTIAL,
+    WORD_PARALLEL,  // параллельно по словам запроса
+    RANGE_PARALLEL, // параллельно по кускам списков id (мало слов, длинные списки)
+};
+
+inline constexpr size_t EXECUTION_PATH_COUNT {3};
+
+// Пороги выбора пути; по умолчанию подобраны так, чтобы короткие запросы шли последовательно
+struct AdaptiveThresholds {
+    size_t min_parallel_postings {50'000};   // FindTopDocuments: суммарная длина списков id плюс-слов
+    size_t min_word_parallel_words {8};      // FindTopDocuments: плюс-слов для параллелизма по словам
+    size_t range_chunk_size {8'192};         // FindTopDocuments: размер куска списка id для RANGE_PARALLEL
+    size_t min_parallel_match_words {256};   // MatchDocument: слов в запросе
+    size_t min_parallel_remove_words {4'096}; // RemoveDocument: слов в документе
+};
+
+// Счётчик выбранных путей; безопасен для вызова из константных методов в нескольких потоках
+class ExecutionPathCounter {
+public:
+    ExecutionPathCounter() = default;
+
+    ExecutionPathCounter(const ExecutionPathCounter& other) {
+        *this = other;
+    }
+
+    ExecutionPathCounter& operator=(const ExecutionPathCounter& other) {
+        for (size_t i = 0; i < EXECUTION_PATH_COUNT; ++i) {
+            counts_[i].store(other.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    void Add(ExecutionPath path) {
+        counts_[static_cast<size_t>(path)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t Get(ExecutionPath path) const {
+        return counts_[static_cast<size_t>(path)].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, EXECUTION_PATH_COUNT> counts_ {};
+};
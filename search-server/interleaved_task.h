@@ -0,0 +1,90 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <vector>
+
+// Корутина для чередования запросов на одном потоке: создаётся приостановленной,
+// каждый Resume выполняет её до следующего co_await (обычно сразу после prefetch) или до конца.
+// Исключение из тела сохраняется и пробрасывается RunInterleaved после завершения всей группы.
+class InterleavedTask {
+public:
+    struct promise_type {
+        std::exception_ptr exception;
+
+        InterleavedTask get_return_object() {
+            return InterleavedTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {
+        }
+
+        void unhandled_exception() noexcept {
+            exception = std::current_exception();
+        }
+    };
+
+    InterleavedTask(InterleavedTask&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr)) {
+    }
+
+    InterleavedTask& operator=(InterleavedTask&& other) noexcept {
+        std::swap(handle_, other.handle_);
+        return *this;
+    }
+
+    InterleavedTask(const InterleavedTask&) = delete;
+    InterleavedTask& operator=(const InterleavedTask&) = delete;
+
+    ~InterleavedTask() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    bool Done() const {
+        return handle_.done();
+    }
+
+    void Resume() {
+        handle_.resume();
+    }
+
+    std::exception_ptr GetException() const {
+        return handle_.promise().exception;
+    }
+
+private:
+    explicit InterleavedTask(std::coroutine_handle<promise_type> handle)
+        : handle_(handle) {
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Возобновляет задачи по кругу, пока все не завершатся: пока одна ждёт подгрузки памяти, работают другие
+inline void RunInterleaved(std::vector<InterleavedTask>& tasks) {
+    for (size_t active = tasks.size(); active > 0;) {
+        active = 0;
+        for (InterleavedTask& task : tasks) {
+            if (!task.Done()) {
+                task.Resume();
+                active += task.Done() ? 0 : 1;
+            }
+        }
+    }
+    for (const InterleavedTask& task : tasks) {
+        if (task.GetException()) {
+            std::rethrow_exception(task.GetException());
+        }
+    }
+}
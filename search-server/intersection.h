@@ -0,0 +1,41 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <iterator>
+
+// Пересечение отсортированного диапазона ключей [first, last) с упорядоченным словарём (std::map).
+// Для каждого общего ключа вызывается callback(элемент словаря).
+// Если ключей мало относительно словаря — каждый ищется через lower_bound (галоп по дереву, O(m * log n)),
+// иначе — линейное слияние двух отсортированных последовательностей, O(m + n).
+template <typename KeyIterator, typename SortedMap, typename Callback>
+void ForEachIntersection(KeyIterator first, KeyIterator last, const SortedMap& sorted_map, Callback callback) {
+    const size_t keys_count = static_cast<size_t>(std::distance(first, last));
+    if (keys_count == 0 || sorted_map.empty()) {
+        return;
+    }
+    const auto less = sorted_map.key_comp();
+
+    if (keys_count * std::bit_width(sorted_map.size()) < keys_count + sorted_map.size()) {
+        for (; first != last; ++first) {
+            const auto pos = sorted_map.lower_bound(*first);
+            if (pos != sorted_map.end() && !less(*first, pos->first)) {
+                callback(*pos);
+            }
+        }
+        return;
+    }
+
+    auto pos = sorted_map.lower_bound(*first);
+    while (first != last && pos != sorted_map.end()) {
+        if (less(*first, pos->first)) {
+            ++first;
+        } else if (less(pos->first, *first)) {
+            ++pos;
+        } else {
+            callback(*pos);
+            ++first;
+            ++pos;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// Гистограмма задержек с логарифмически-линейными корзинами, как в HdrHistogram: каждая степень двойки
+// делится на SUB_BUCKET_COUNT равных корзин, так что относительная ошибка значения не больше 1/SUB_BUCKET_COUNT
+// (меньше 0.8%, две-три значащие цифры). Память постоянна (~37 КБ), Record — один атомарный инкремент,
+// поэтому писать можно из нескольких потоков.
+// В отличие от LatencyRecorder отдельные замеры не хранятся.
+class LatencyHistogram {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    static constexpr int SUB_BUCKET_BITS = 7;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 42; // старше ~2.4 часа значения попадают в последнюю корзину
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Record(Duration latency) {
+        counts_[GetBucketIndex(latency)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // other может одновременно пополняться: добавленное после чтения корзины не учитывается
+    void Merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            if (const uint64_t count = other.counts_[i].load(std::memory_order_relaxed)) {
+                counts_[i].fetch_add(count, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // не атомарно относительно одновременных Record: вызывается, когда в гистограмму не пишут
+    void Clear() {
+        for (auto& count : counts_) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t GetCount() const {
+        uint64_t total = 0;
+        for (const auto& count : counts_) {
+            total += count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // percentile в [0, 100], ближайший ранг; возвращается верхняя граница корзины, без замеров — ноль
+    Duration GetPercentile(double percentile) const {
+        const uint64_t total = GetCount();
+        if (total == 0) {
+            return Duration::zero();
+        }
+        const uint64_t rank = std::clamp<uint64_t>(static_cast<uint64_t>(std::ceil(percentile / 100.0 * total)), 1, total);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return Duration(GetBucketUpperBound(i));
+            }
+        }
+        return Duration(GetBucketUpperBound(BUCKET_COUNT - 1));
+    }
+
+    Duration GetMax() const {
+        return GetPercentile(100.0);
+    }
+
+    static size_t GetBucketIndex(Duration latency) {
+        const uint64_t value = std::min<uint64_t>(std::max<int64_t>(latency.count(), 0),
+                                                  (uint64_t{1} << (MAX_EXPONENT + 1)) - 1);
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        const int exponent = std::bit_width(value) - 1;
+        const uint64_t sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+        return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub_bucket);
+    }
+
+    static uint64_t GetBucketUpperBound(size_t index) {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+        const int shift = static_cast<int>(index / SUB_BUCKET_COUNT) - 1;
+        const uint64_t lower = (SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+        return lower + (uint64_t{1} << shift) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_ {};
+};
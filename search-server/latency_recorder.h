@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+// Задержки отдельных запросов и их перцентили. Хранит все замеры: рассчитан на прогоны нагрузочных тестов,
+// а не на постоянный учёт в сервере. Не потокобезопасен: у каждого потока свой, потом Merge.
+class LatencyRecorder {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    void Add(Duration latency) {
+        samples_.push_back(latency);
+        sorted_ = false;
+    }
+
+    void Merge(const LatencyRecorder& other) {
+        samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end());
+        sorted_ = false;
+    }
+
+    size_t GetCount() const {
+        return samples_.size();
+    }
+
+    // percentile в [0, 100], ближайший ранг; без замеров — ноль
+    Duration GetPercentile(double percentile) {
+        if (samples_.empty()) {
+            return Duration::zero();
+        }
+        Sort();
+        const double rank = std::ceil(percentile / 100.0 * samples_.size());
+        const size_t index = std::clamp<size_t>(static_cast<size_t>(rank), 1, samples_.size()) - 1;
+        return samples_[index];
+    }
+
+    Duration GetMax() {
+        return GetPercentile(100.0);
+    }
+
+private:
+    void Sort() {
+        if (!sorted_) {
+            std::sort(samples_.begin(), samples_.end());
+            sorted_ = true;
+        }
+    }
+
+    std::vector<Duration> samples_;
+    bool sorted_ {true};
+};
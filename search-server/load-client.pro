@@ -0,0 +1,22 @@
+TEMPLATE = app
+TARGET = load-client
+CONFIG += console c++20
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+        document.cpp \
+        load_client_main.cpp \
+        query_client.cpp \
+        query_protocol.cpp \
+        read_input_functions.cpp
+
+HEADERS += \
+    binary_io.h \
+    document.h \
+    latency_recorder.h \
+    query_client.h \
+    query_protocol.h \
+    read_input_functions.h
+
+LIBS += -lpthread
@@ -0,0 +1,37 @@
+TEMPLATE = app
+TARGET = load-generator
+CONFIG += console c++20
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+        document.cpp \
+        document_filter.cpp \
+        load_generator.cpp \
+        load_generator_main.cpp \
+        read_input_functions.cpp \
+        scratch_arena.cpp \
+        search_server.cpp \
+        string_processing.cpp \
+        trace.cpp
+
+HEADERS += \
+    concurrent_map.h \
+    document.h \
+    document_filter.h \
+    execution_mode.h \
+    interleaved_task.h \
+    intersection.h \
+    latency_recorder.h \
+    load_generator.h \
+    memory_accounting.h \
+    plan_cache.h \
+    query_stats.h \
+    read_input_functions.h \
+    scratch_arena.h \
+    search_server.h \
+    string_processing.h \
+    trace.h
+
+LIBS += -ltbb \
+        -lpthread
@@ -0,0 +1,57 @@
+// Нагрузочный клиент QueryServer: закрытый цикл по N соединениям, запросы из файла по кругу.
+//
+//   load-client --queries queries.txt (--unix /tmp/search.sock | --port 8080)
+//               [--connections 4] [--requests 1000] [--pipeline 8]
+
+#include "query_client.h"
+#include "read_input_functions.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    string queries_path;
+    LoadOptions options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const string_view name = argv[i];
+        const string value = argv[i + 1];
+        if (name == "--queries"sv) {
+            queries_path = value;
+        } else if (name == "--unix"sv) {
+            options.unix_path = value;
+        } else if (name == "--port"sv) {
+            options.port = static_cast<uint16_t>(stoi(value));
+        } else if (name == "--connections"sv) {
+            options.connections = stoul(value);
+        } else if (name == "--requests"sv) {
+            options.requests_per_connection = stoul(value);
+        } else if (name == "--pipeline"sv) {
+            options.pipeline_depth = stoul(value);
+        } else {
+            cerr << "Неизвестный параметр "sv << name << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (queries_path.empty()) {
+        cerr << "Нужен --queries FILE"sv << endl;
+        return EXIT_FAILURE;
+    }
+
+    LoadReport report = RunQueryLoad(options, ReadFileLines(queries_path));
+    const auto to_us = [](LatencyRecorder::Duration latency) {
+        return chrono::duration<double, micro>(latency).count();
+    };
+    cout << fixed << setprecision(1)
+         << "requests: "sv << report.requests << ", errors: "sv << report.errors << '\n'
+         << "qps: "sv << report.GetQps() << '\n'
+         << "latency us: p50 "sv << to_us(report.latencies.GetPercentile(50))
+         << ", p90 "sv << to_us(report.latencies.GetPercentile(90))
+         << ", p99 "sv << to_us(report.latencies.GetPercentile(99))
+         << ", max "sv << to_us(report.latencies.GetMax()) << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#include "load_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double REPORTED_PERCENTILES[] = {50.0, 90.0, 99.0, 99.9};
+
+double ToMicroseconds(LatencyRecorder::Duration latency) {
+    return std::chrono::duration<double, std::micro>(latency).count();
+}
+
+} // namespace
+
+std::vector<std::string> RankWordsByFrequency(const SearchServer& search_server) {
+    std::unordered_map<std::string_view, size_t> counts; // слово -> длина его списка id
+    for (const int document_id : search_server) {
+        for (const auto& [word, _] : search_server.GetWordCounts(document_id)) {
+            ++counts[word];
+        }
+    }
+    std::vector<std::pair<std::string_view, size_t>> ranked(counts.begin(), counts.end());
+    std::sort(ranked.begin(), ranked.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+    });
+    std::vector<std::string> words;
+    words.reserve(ranked.size());
+    for (const auto& [word, count] : ranked) {
+        words.emplace_back(word);
+    }
+    return words;
+}
+
+std::vector<std::string> GenerateZipfQueries(const std::vector<std::string>& ranked_words, size_t query_count,
+                                             size_t max_words, double exponent, uint64_t seed) {
+    if (ranked_words.empty() || max_words == 0) {
+        throw std::invalid_argument("Для генерации запросов нужны слова.");
+    }
+    // накопленные веса 1 / r^s: слово ищется по равномерной точке на [0, сумма)
+    std::vector<double> cumulative(ranked_words.size());
+    double total = 0.0;
+    for (size_t rank = 0; rank < ranked_words.size(); ++rank) {
+        total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+        cumulative[rank] = total;
+    }
+
+    std::mt19937_64 generator(seed);
+    std::uniform_real_distribution<double> point(0.0, total);
+    std::uniform_int_distribution<size_t> word_count(1, max_words);
+    std::vector<std::string> queries(query_count);
+    for (std::string& query : queries) {
+        for (size_t i = word_count(generator); i > 0; --i) {
+            const size_t rank = std::min<size_t>(std::upper_bound(cumulative.begin(), cumulative.end(), point(generator))
+                                                 - cumulative.begin(), ranked_words.size() - 1);
+            if (!query.empty()) {
+                query += ' ';
+            }
+            query += ranked_words[rank];
+        }
+    }
+    return queries;
+}
+
+ReplayReport RunReplay(const SearchServer& search_server, const std::vector<std::string>& queries,
+                       const ReplayOptions& options) {
+    if (queries.empty()) {
+        throw std::invalid_argument("Нет запросов для воспроизведения.");
+    }
+    const size_t thread_count = std::max<size_t>(1, options.threads);
+    std::vector<LatencyRecorder> latencies(thread_count);
+    std::vector<size_t> errors(thread_count, 0);
+    std::atomic<size_t> next_request {0};
+
+    const auto start = Clock::now();
+    const auto worker = [&](size_t thread_index) {
+        for (size_t request = next_request++; request < options.requests; request = next_request++) {
+            Clock::time_point scheduled = Clock::now();
+            if (options.target_qps > 0.0) {
+                scheduled = start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(request / options.target_qps));
+                std::this_thread::sleep_until(scheduled);
+            }
+            try {
+                [[maybe_unused]] const auto documents = search_server.FindTopDocuments(queries[request % queries.size()]);
+            } catch (const std::invalid_argument&) {
+                ++errors[thread_index];
+            }
+            latencies[thread_index].Add(Clock::now() - scheduled);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ReplayReport report;
+    report.elapsed = Clock::now() - start;
+    for (size_t i = 0; i < thread_count; ++i) {
+        report.latencies.Merge(latencies[i]);
+        report.errors += errors[i];
+    }
+    report.requests = report.latencies.GetCount();
+    return report;
+}
+
+void PrintReplayReport(std::ostream& out, ReplayReport& report, const ReplayOptions& options) {
+    out << "mode: "<< (options.target_qps > 0.0 ? "open loop, target " + std::to_string(options.target_qps) + " qps"
+                                                 : "closed loop")
+        << ", threads: " << options.threads << '\n'
+        << "requests: " << report.requests << ", errors: " << report.errors << '\n'
+        << "throughput: " << report.GetQps() << " qps\n"
+        << "latency us:";
+    for (const double percentile : REPORTED_PERCENTILES) {
+        out << " p" << percentile << ' ' << ToMicroseconds(report.latencies.GetPercentile(percentile));
+    }
+    out << " max " << ToMicroseconds(report.latencies.GetMax()) << std::endl;
+}
+
+void PrintReplayReportJson(std::ostream& out, ReplayReport& report, const ReplayOptions& options) {
+    out << "{\"mode\": \"" << (options.target_qps > 0.0 ? "open" : "closed") << "\""
+        << ", \"target_qps\": " << options.target_qps
+        << ", \"threads\": " << options.threads
+        << ", \"requests\": " << report.requests
+        << ", \"errors\": " << report.errors
+        << ", \"elapsed_seconds\": " << report.elapsed.count()
+        << ", \"qps\": " << report.GetQps()
+        << ", \"latency_us\": {";
+    for (const double percentile : REPORTED_PERCENTILES) {
+        out << "\"p" << percentile << "\": " << ToMicroseconds(report.latencies.GetPercentile(percentile)) << ", ";
+    }
+    out << "\"max\": " << ToMicroseconds(report.latencies.GetMax()) << "}}" << std::endl;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "latency_recorder.h"
+#include "search_server.h"
+
+// Слова индекса по убыванию числа документов с ними: ранг 1 — самое частое. Словарь для GenerateZipfQueries.
+// Стоп-слов в индексе нет, поэтому и запросы из них не составляются.
+std::vector<std::string> RankWordsByFrequency(const SearchServer& search_server);
+
+// Синтетические запросы: от 1 до max_words слов, слово ранга r выбирается с вероятностью ~ 1 / r^exponent.
+// Один seed — одни и те же запросы.
+std::vector<std::string> GenerateZipfQueries(const std::vector<std::string>& ranked_words, size_t query_count,
+                                             size_t max_words, double exponent, uint64_t seed);
+
+struct ReplayOptions {
+    size_t threads {1};
+    size_t requests {10'000}; // всего запросов; запросы берутся по кругу
+    double target_qps {0.0};  // 0 — закрытый цикл (каждый поток шлёт следующий сразу), иначе открытый с таким темпом
+};
+
+// В открытом цикле задержка отсчитывается от запланированного момента запроса, а не от фактического:
+// если сервер не успевает, очередь ожидания попадает в перцентили, а не прячется (coordinated omission).
+struct ReplayReport {
+    size_t requests {0};
+    size_t errors {0}; // запросы, отклонённые разбором
+    std::chrono::duration<double> elapsed {0};
+    LatencyRecorder latencies;
+
+    double GetQps() const {
+        return elapsed.count() > 0 ? requests / elapsed.count() : 0.0;
+    }
+};
+
+ReplayReport RunReplay(const SearchServer& search_server, const std::vector<std::string>& queries,
+                       const ReplayOptions& options);
+
+void PrintReplayReport(std::ostream& out, ReplayReport& report, const ReplayOptions& options);
+void PrintReplayReportJson(std::ostream& out, ReplayReport& report, const ReplayOptions& options);
@@ -0,0 +1,86 @@
+// Генератор нагрузки без сети: индексирует файл документов (строка — документ) и прогоняет по индексу
+// журнал запросов или синтетические запросы с распределением слов по Ципфу.
+//
+//   load-generator --documents docs.txt [--stop-words "и в на"]
+//                  (--queries queries.txt | [--zipf-queries 10000] [--zipf-exponent 1.0] [--max-words 3] [--seed 42])
+//                  [--threads 4] [--requests 100000] [--qps 0] [--json 1]
+
+#include "load_generator.h"
+#include "read_input_functions.h"
+
+#include <cstdlib>
+#include <execution>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    string documents_path;
+    string queries_path;
+    string stop_words;
+    size_t zipf_query_count = 10'000;
+    double zipf_exponent = 1.0;
+    size_t max_words = 3;
+    uint64_t seed = 42;
+    bool json = false;
+    ReplayOptions options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const string_view name = argv[i];
+        const string value = argv[i + 1];
+        if (name == "--documents"sv) {
+            documents_path = value;
+        } else if (name == "--queries"sv) {
+            queries_path = value;
+        } else if (name == "--stop-words"sv) {
+            stop_words = value;
+        } else if (name == "--zipf-queries"sv) {
+            zipf_query_count = stoul(value);
+        } else if (name == "--zipf-exponent"sv) {
+            zipf_exponent = stod(value);
+        } else if (name == "--max-words"sv) {
+            max_words = stoul(value);
+        } else if (name == "--seed"sv) {
+            seed = stoull(value);
+        } else if (name == "--threads"sv) {
+            options.threads = stoul(value);
+        } else if (name == "--requests"sv) {
+            options.requests = stoul(value);
+        } else if (name == "--qps"sv) {
+            options.target_qps = stod(value);
+        } else if (name == "--json"sv) {
+            json = value != "0"sv;
+        } else {
+            cerr << "Неизвестный параметр "sv << name << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (documents_path.empty()) {
+        cerr << "Нужен --documents FILE"sv << endl;
+        return EXIT_FAILURE;
+    }
+
+    const vector<string> texts = ReadFileLines(documents_path);
+    vector<SearchServer::DocumentSource> documents(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        documents[i].id = static_cast<int>(i);
+        documents[i].text = texts[i];
+    }
+    SearchServer search_server(stop_words);
+    search_server.AddDocuments(execution::par, documents);
+
+    const vector<string> queries = queries_path.empty()
+            ? GenerateZipfQueries(RankWordsByFrequency(search_server), zipf_query_count, max_words, zipf_exponent, seed)
+            : ReadFileLines(queries_path);
+    cerr << "Проиндексировано документов: "sv << search_server.GetDocumentCount()
+         << ", различных запросов: "sv << queries.size() << endl;
+
+    ReplayReport report = RunReplay(search_server, queries, options);
+    if (json) {
+        PrintReplayReportJson(cout, report, options);
+    } else {
+        PrintReplayReport(cout, report, options);
+    }
+    return EXIT_SUCCESS;
+}
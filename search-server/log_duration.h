@@ -30,7 +30,9 @@
  *      Task2();
  *  }
  */
+#ifndef LOG_DURATION_TO_TRACE
 #define LOG_DURATION(x) LogDuration UNIQUE_VAR_NAME_PROFILE(x)
+#endif
 
 /**
  *
@@ -40,7 +42,14 @@
  *      ...
  *  }
  */
+#ifndef LOG_DURATION_TO_TRACE
 #define LOG_DURATION_STREAM(x, y) LogDuration UNIQUE_VAR_NAME_PROFILE(x, y)
+#else
+// С -DLOG_DURATION_TO_TRACE замеры пишутся в трассировку (trace.h), а не печатаются; поток игнорируется
+#include "trace.h"
+#define LOG_DURATION(x) TRACE_SCOPE(x)
+#define LOG_DURATION_STREAM(x, y) TRACE_SCOPE(x)
+#endif
 
 class LogDuration {
 public:
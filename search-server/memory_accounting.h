@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+// Ресурс-счётчик: передаёт выделения вышестоящему ресурсу и считает занятые через него байты.
+// Счётчики атомарные: параллельные RemoveDocument и запросы освобождают и выделяют память из разных потоков
+// (поэтому и вышестоящий ресурс в этих режимах должен быть потокобезопасным).
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream) {
+    }
+
+    size_t GetBytes() const {
+        return bytes_.load(std::memory_order_relaxed);
+    }
+
+    size_t GetPeakBytes() const {
+        return peak_bytes_.load(std::memory_order_relaxed);
+    }
+
+    std::pmr::memory_resource* GetUpstream() const {
+        return upstream_;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* ptr = upstream_->allocate(bytes, alignment);
+        const size_t in_use = bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+        while (in_use > peak && !peak_bytes_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+        }
+        return ptr;
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(ptr, bytes, alignment);
+        bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> bytes_ {0};
+    std::atomic<size_t> peak_bytes_ {0};
+};
+
+// Память SearchServer по структурам, в байтах, запрошенных у ресурса (без служебных данных самого ресурса)
+struct MemoryStats {
+    size_t terms {0};         // словарь: узлы и строки слов, стоп-слова
+    size_t postings {0};      // списки (статус, id) -> tf
+    size_t forward_index {0}; // id -> слова документа
+    size_t attributes {0};    // рейтинги и статусы документов, индексы атрибутов
+    size_t caches {0};        // кэш планов запросов
+
+    size_t Total() const {
+        return terms + postings + forward_index + attributes + caches;
+    }
+};
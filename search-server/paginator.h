@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <iterator>
 #include <vector>
 #include <algorithm>
 
@@ -40,39 +41,98 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& range
     return out;
 }
 
+// Страницы строятся по мере обхода, а не заранее.
+// По многопроходным итераторам страница — IteratorRange поверх исходных данных;
+// по однопроходным (потоковым) — IteratorRange по буферу очередной страницы, который перезаполняется при ++.
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        assert(end >= begin && page_size > 0);//Dmitrii Mamontov review
-        for (size_t left = std::distance(begin, end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = std::next(begin, current_page_size);
-            pages_.push_back({begin, current_page_end});
-
-            left -= current_page_size;
-            begin = current_page_end;
-        }
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin)
+        , end_(end)
+        , page_size_(page_size) {
+        assert(page_size > 0);//Dmitrii Mamontov review
     }
 
-    auto begin() const {
-        return pages_.begin();
+    class PageIterator {
+    public:
+        PageIterator(Iterator begin, Iterator end, size_t page_size)
+            : page_begin_(begin)
+            , page_end_(begin)
+            , end_(end)
+            , page_size_(page_size) {
+            Advance();
+        }
+
+        auto operator*() const {
+            if constexpr (std::forward_iterator<Iterator>) {
+                return IteratorRange<Iterator>(page_begin_, page_end_);
+            } else {
+                return IteratorRange(page_.cbegin(), page_.cend());
+            }
+        }
+
+        PageIterator& operator++() {
+            Advance();
+            return *this;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            if constexpr (std::forward_iterator<Iterator>) {
+                return page_begin_ == other.page_begin_;
+            } else {
+                return page_.empty() == other.page_.empty(); // однопроходные страницы сравниваются только с концом
+            }
+        }
+
+    private:
+        void Advance() {
+            if constexpr (std::forward_iterator<Iterator>) {
+                page_begin_ = page_end_;
+                if constexpr (std::random_access_iterator<Iterator>) {
+                    page_end_ = std::next(page_begin_, std::min<std::iter_difference_t<Iterator>>(page_size_, end_ - page_begin_));
+                } else {
+                    for (size_t i = 0; i < page_size_ && page_end_ != end_; ++i) {
+                        ++page_end_;
+                    }
+                }
+            } else {
+                page_.clear();
+                for (; page_.size() < page_size_ && page_end_ != end_; ++page_end_) {
+                    page_.push_back(*page_end_);
+                }
+            }
+        }
+
+        Iterator page_begin_;
+        Iterator page_end_; // для однопроходных — позиция чтения
+        Iterator end_;
+        size_t page_size_;
+        std::vector<std::iter_value_t<Iterator>> page_;
+    };
+
+    PageIterator begin() const {
+        return PageIterator(begin_, end_, page_size_);
     }
 
-    auto end() const {
-        return pages_.end();
+    PageIterator end() const {
+        return PageIterator(end_, end_, page_size_);
     }
 
-    size_t size() const {
-        return pages_.size();
+    size_t size() const requires std::forward_iterator<Iterator> {
+        const size_t count = std::distance(begin_, end_);
+        return (count + page_size_ - 1) / page_size_;
     }
 
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator begin_;
+    Iterator end_;
+    size_t page_size_;
 };
 
 template <typename Container>
-auto Paginate(const Container& c, size_t page_size) {
+auto Paginate(Container&& c, size_t page_size) {
+    using std::begin;
+    using std::end;
     return Paginator(begin(c), end(c), page_size);
 }
-
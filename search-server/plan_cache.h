@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Потокобезопасный LRU-кэш планов запросов. Как и в ConcurrentMap, ключи разбиты на сегменты
+// со своим мьютексом, чтобы параллельные запросы не ждали друг друга.
+// Запись действительна, пока не изменилась версия индекса, с которой она была построена.
+// Кэш не копируется: планы ссылаются на индекс конкретного сервера.
+template <typename Plan>
+class PlanCache {
+public:
+    explicit PlanCache(std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+                       size_t capacity = 4096, size_t shard_count = 16)
+        : shards_(shard_count, resource)
+        , shard_capacity_(std::max<size_t>(1, capacity / shard_count)) {
+    }
+
+    PlanCache(const PlanCache&) = delete;
+    PlanCache& operator=(const PlanCache&) = delete;
+    PlanCache(PlanCache&&) = default;
+
+    std::shared_ptr<const Plan> Find(const std::pmr::string& key, uint64_t version) {
+        Shard& shard = GetShard(key);
+        std::lock_guard guard(shard.mutex);
+        const auto pos = shard.entries.find(key);
+        if (pos == shard.entries.end() || pos->second.version != version) {
+            return nullptr;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, pos->second.lru_pos);
+        return pos->second.plan;
+    }
+
+    void Insert(const std::pmr::string& key, uint64_t version, std::shared_ptr<const Plan> plan) {
+        Shard& shard = GetShard(key);
+        std::lock_guard guard(shard.mutex);
+        const auto pos = shard.entries.find(key);
+        if (pos != shard.entries.end()) {
+            pos->second.version = version;
+            pos->second.plan = std::move(plan);
+            shard.lru.splice(shard.lru.begin(), shard.lru, pos->second.lru_pos);
+            return;
+        }
+        if (shard.entries.size() >= shard_capacity_) {
+            shard.entries.erase(shard.lru.back());
+            shard.lru.pop_back();
+        }
+        shard.lru.push_front(key);
+        shard.entries.emplace(key, Entry{version, std::move(plan), shard.lru.begin()});
+    }
+
+    void Clear() {
+        for (Shard& shard : shards_) {
+            std::lock_guard guard(shard.mutex);
+            shard.entries.clear();
+            shard.lru.clear();
+        }
+    }
+
+private:
+    struct Entry {
+        uint64_t version {0};
+        std::shared_ptr<const Plan> plan;
+        std::pmr::list<std::pmr::string>::iterator lru_pos;
+    };
+
+    struct Shard {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        explicit Shard(const allocator_type& allocator)
+            : entries(allocator)
+            , lru(allocator) {
+        }
+
+        std::mutex mutex;
+        std::pmr::unordered_map<std::pmr::string, Entry> entries;
+        std::pmr::list<std::pmr::string> lru; // спереди — недавно использованные
+    };
+
+    Shard& GetShard(const std::pmr::string& key) {
+        return shards_[std::hash<std::pmr::string>{}(key) % shards_.size()];
+    }
+
+    std::pmr::vector<Shard> shards_;
+    size_t shard_capacity_;
+};
@@ -1,6 +1,8 @@
 #include "process_queries.h"
 #include <execution>
 #include <functional>
+#include <numeric>
+#include <span>
 
 std::vector<std::vector<Document>>ProcessQueries (const SearchServer& search_server,
                                                      const std::vector<std::string>& queries) {
@@ -10,29 +12,137 @@ std::vector<std::vector<Document>>ProcessQueries (const SearchServer& search_ser
                    queries.begin(), queries.end(),
                    result.begin(),
                    [&search_server](const std::string& query) {
+                        TRACE_SCOPE("ProcessQueries/query");
                         return search_server.FindTopDocuments(query);
                    });
     return result;
 }
 
+std::vector<std::vector<Document>> ProcessQueriesInterleaved(const SearchServer& search_server,
+                                                             const std::vector<std::string>& queries,
+                                                             size_t group_size) {
+    group_size = std::max<size_t>(1, group_size);
+    std::vector<std::vector<Document>> result(queries.size());
+    std::vector<size_t> group_begins((queries.size() + group_size - 1) / group_size);
+    for (size_t i = 0; i < group_begins.size(); ++i) {
+        group_begins[i] = i * group_size;
+    }
+    std::for_each(std::execution::par,
+                  group_begins.begin(), group_begins.end(),
+                  [&](size_t group_begin) {
+                      TRACE_SCOPE("ProcessQueriesInterleaved/group");
+                      const auto group = std::span<const std::string>(queries).subspan(
+                              group_begin, std::min(group_size, queries.size() - group_begin));
+                      auto documents = search_server.FindTopDocumentsInterleaved(group, group_size);
+                      std::move(documents.begin(), documents.end(), result.begin() + group_begin);
+                  });
+    return result;
+}
+
+namespace {
+
+QueryResults ProcessQueriesFlat(const SearchServer& search_server, std::span<const std::string> queries) {
+    std::vector<Document> slots(queries.size() * MAX_RESULT_DOCUMENT_COUNT);
+    std::vector<size_t> sizes(queries.size());
+
+    // параллельные алгоритмы могут передавать копии элементов, поэтому номер запроса не выводится из адреса
+    std::vector<size_t> indexes(queries.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+
+    std::for_each(std::execution::par,
+                  indexes.begin(), indexes.end(),
+                  [&](size_t index) {
+                      TRACE_SCOPE("ProcessQueriesFlat/query");
+                      const auto query_slots = std::span<Document>(slots).subspan(index * MAX_RESULT_DOCUMENT_COUNT,
+                                                                                  MAX_RESULT_DOCUMENT_COUNT);
+                      sizes[index] = search_server.FindTopDocuments(queries[index], DocumentStatus::ACTUAL, query_slots);
+                  });
+    return QueryResults(std::move(slots), std::move(sizes));
+}
+
+} // namespace
+
+QueryResults ProcessQueriesFlat( const SearchServer& search_server,
+                                 const std::vector<std::string>& queries) {
+    return ProcessQueriesFlat(search_server, std::span<const std::string>(queries));
+}
+
 std::vector<Document> ProcessQueriesJoined( const SearchServer& search_server,
                                             const std::vector<std::string>& queries) {
-    auto responses = ProcessQueries(search_server, queries);
-    size_t doc_count = std::transform_reduce(std::execution::par,
-                                             responses.begin(), responses.end(),
-                                             0u,
-                                             std::plus<>(),
-                                             [](const std::vector<Document>& response){
-                                                return response.size();
-                                             });
-    std::vector<Document> result;
-    result.reserve(doc_count);
-    for (const auto& response : responses) {
-        std::move(response.begin(), response.end(), std::back_inserter(result));
+    const QueryResults results = ProcessQueriesFlat(search_server, queries);
+    std::vector<Document> documents;
+    documents.reserve(results.GetDocumentCount());
+    for (const std::span<const Document> query_documents : results) {
+        documents.insert(documents.end(), query_documents.begin(), query_documents.end());
     }
+    return documents;
+}
 
-    return result;
+DocumentStream::DocumentStream(const SearchServer& search_server, const std::vector<std::string>& queries,
+                               size_t batch_size)
+    : search_server_(search_server)
+    , queries_(queries)
+    , batch_size_(std::max<size_t>(1, batch_size)) {
+    StartNextBatch();
+    FetchNextBatch();
+}
+
+DocumentStream::~DocumentStream() {
+    if (next_batch_.valid()) {
+        next_batch_.wait();
+    }
+}
+
+DocumentStream::Iterator DocumentStream::begin() {
+    return Iterator(this);
+}
+
+DocumentStream::Iterator DocumentStream::end() {
+    return Iterator(nullptr);
+}
+
+size_t DocumentStream::GetQueryIndex() const {
+    return batch_begin_ + query_;
+}
+
+void DocumentStream::StartNextBatch() {
+    if (next_batch_begin_ >= queries_.size()) {
+        return;
+    }
+    const std::span<const std::string> batch = std::span<const std::string>(queries_).subspan(
+            next_batch_begin_, std::min(batch_size_, queries_.size() - next_batch_begin_));
+    next_batch_begin_ += batch.size();
+    next_batch_ = std::async(std::launch::async, [this, batch] {
+        return ProcessQueriesFlat(search_server_, batch);
+    });
+}
+
+void DocumentStream::FetchNextBatch() {
+    // пропускаем запросы и пакеты без результатов, пока не найдём документ или запросы не кончатся
+    for (;;) {
+        while (query_ < batch_.size() && position_ == batch_[query_].size()) {
+            ++query_;
+            position_ = 0;
+        }
+        if (query_ < batch_.size() || !next_batch_.valid()) {
+            return;
+        }
+        batch_begin_ += batch_.size();
+        batch_ = next_batch_.get();
+        query_ = 0;
+        StartNextBatch(); // следующий пакет считается, пока читают текущий
+    }
 }
+
+void DocumentStream::Advance() {
+    ++position_;
+    FetchNextBatch();
+}
+
+bool DocumentStream::IsExhausted() const {
+    return query_ == batch_.size() && !next_batch_.valid();
+}
+
 // ================try_for_yourself=============================
 /*
 std::list<Document> ProcessQueriesJoined_list( const SearchServer& search_server,
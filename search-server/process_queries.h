@@ -1,14 +1,185 @@
 #pragma once
 
 #include "search_server.h"
+
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <numeric>
+#include <span>
 //#include <list>
 
+// Результаты пакета запросов в одном буфере: на запрос отведено MAX_RESULT_DOCUMENT_COUNT мест,
+// i-й запрос занимает первые sizes_[i] из них. Документы пишутся поиском прямо в свои места и не уплотняются.
+// Обход даёт по одному std::span<const Document> на запрос, без копий и отдельных векторов.
+class QueryResults {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::span<const Document>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator() = default;
+        Iterator(const QueryResults* results, size_t index)
+            : results_(results)
+            , index_(index) {
+        }
+
+        std::span<const Document> operator*() const {
+            return (*results_)[index_];
+        }
+
+        Iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++index_;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return index_ == other.index_;
+        }
+
+    private:
+        const QueryResults* results_ {nullptr};
+        size_t index_ {0};
+    };
+
+    QueryResults() = default;
+    // slots — sizes.size() * MAX_RESULT_DOCUMENT_COUNT мест
+    QueryResults(std::vector<Document> slots, std::vector<size_t> sizes)
+        : slots_(std::move(slots))
+        , sizes_(std::move(sizes))
+        , document_count_(std::accumulate(sizes_.begin(), sizes_.end(), size_t{0})) {
+    }
+
+    size_t size() const {
+        return sizes_.size();
+    }
+
+    std::span<const Document> operator[](size_t query_index) const {
+        return std::span<const Document>(slots_).subspan(query_index * MAX_RESULT_DOCUMENT_COUNT, sizes_[query_index]);
+    }
+
+    Iterator begin() const {
+        return Iterator(this, 0);
+    }
+
+    Iterator end() const {
+        return Iterator(this, size());
+    }
+
+    size_t GetDocumentCount() const { // документы всех запросов
+        return document_count_;
+    }
+
+private:
+    std::vector<Document> slots_;
+    std::vector<size_t> sizes_;
+    size_t document_count_ {0};
+};
+
 std::vector<std::vector<Document>>ProcessQueries ( const SearchServer& search_server,
                                                    const std::vector<std::string>& queries);
 
+// Как ProcessQueries, но каждый поток выполняет свою группу из group_size запросов чередованием корутин
+// (SearchServer::FindTopDocumentsInterleaved), скрывая задержки памяти одного запроса работой других.
+std::vector<std::vector<Document>> ProcessQueriesInterleaved(const SearchServer& search_server,
+                                                             const std::vector<std::string>& queries,
+                                                             size_t group_size = 16);
+
+// Потоки пишут результаты сразу в общий буфер через SearchServer::FindTopDocuments(query, status, span):
+// кандидаты каждого запроса живут в ScratchArena потока, лучшие записываются в места запроса один раз.
+QueryResults ProcessQueriesFlat( const SearchServer& search_server,
+                                 const std::vector<std::string>& queries);
+
 std::vector<Document> ProcessQueriesJoined( const SearchServer& search_server,
                                             const std::vector<std::string>& queries);
 
+// Потоковый вариант ProcessQueriesJoined: документы читаются по мере готовности.
+// Запросы считаются пакетами по batch_size через ProcessQueriesFlat; пока читается текущий пакет,
+// следующий уже считается в фоне, так что первые документы доступны после первого пакета, а не всех запросов.
+// Однопроходный: begin() вызывается один раз, ++ переходит к следующему документу.
+// search_server и queries должны жить дольше потока.
+class DocumentStream {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator() = default;
+        explicit Iterator(DocumentStream* stream)
+            : stream_(stream) {
+        }
+
+        const Document& operator*() const {
+            return stream_->batch_[stream_->query_][stream_->position_];
+        }
+
+        const Document* operator->() const {
+            return &**this;
+        }
+
+        Iterator& operator++() {
+            stream_->Advance();
+            return *this;
+        }
+
+        void operator++(int) {
+            ++*this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return IsEnd() == other.IsEnd();
+        }
+
+    private:
+        bool IsEnd() const {
+            return stream_ == nullptr || stream_->IsExhausted();
+        }
+
+        DocumentStream* stream_ {nullptr};
+    };
+
+    DocumentStream(const SearchServer& search_server, const std::vector<std::string>& queries, size_t batch_size = 256);
+    ~DocumentStream();
+
+    DocumentStream(const DocumentStream&) = delete;
+    DocumentStream& operator=(const DocumentStream&) = delete;
+
+    Iterator begin();
+    Iterator end();
+
+    size_t GetQueryIndex() const; // запрос, которому принадлежит текущий документ
+
+private:
+    void StartNextBatch();
+    void FetchNextBatch();
+    void Advance();
+    bool IsExhausted() const;
+
+    const SearchServer& search_server_;
+    const std::vector<std::string>& queries_;
+    size_t batch_size_;
+    QueryResults batch_;            // пакет, из которого сейчас читают
+    size_t batch_begin_ {0};        // номер первого запроса batch_
+    size_t query_ {0};              // текущий запрос в batch_
+    size_t position_ {0};           // текущий документ в результатах запроса query_
+    size_t next_batch_begin_ {0};
+    std::future<QueryResults> next_batch_;
+};
+
 /*
 std::list<Document> ProcessQueriesJoined_list( const SearchServer& search_server,
                                             const std::vector<std::string>& queries);
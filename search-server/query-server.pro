@@ -0,0 +1,39 @@
+TEMPLATE = app
+TARGET = query-server
+CONFIG += console c++20
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+        document.cpp \
+        document_filter.cpp \
+        query_protocol.cpp \
+        query_server.cpp \
+        query_server_main.cpp \
+        read_input_functions.cpp \
+        scratch_arena.cpp \
+        search_server.cpp \
+        string_processing.cpp \
+        trace.cpp
+
+HEADERS += \
+    binary_io.h \
+    concurrent_map.h \
+    document.h \
+    document_filter.h \
+    execution_mode.h \
+    interleaved_task.h \
+    intersection.h \
+    memory_accounting.h \
+    plan_cache.h \
+    query_protocol.h \
+    query_server.h \
+    query_stats.h \
+    read_input_functions.h \
+    scratch_arena.h \
+    search_server.h \
+    string_processing.h \
+    trace.h
+
+LIBS += -ltbb \
+        -lpthread
@@ -0,0 +1,186 @@
+#include "query_client.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace
+
+QueryClient QueryClient::ConnectUnix(const std::string& path) {
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Слишком длинный путь Unix-сокета.");
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    QueryClient client(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (client.fd_ < 0 || ::connect(client.fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ThrowSystemError("Не удалось подключиться к " + path);
+    }
+    return client;
+}
+
+QueryClient QueryClient::ConnectTcp(uint16_t port) {
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    QueryClient client(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (client.fd_ < 0 || ::connect(client.fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ThrowSystemError("Не удалось подключиться к порту " + std::to_string(port));
+    }
+    const int no_delay = 1;
+    ::setsockopt(client.fd_, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    return client;
+}
+
+QueryClient::QueryClient(int fd)
+    : fd_(fd) {
+}
+
+QueryClient::QueryClient(QueryClient&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1))
+    , next_request_id_(other.next_request_id_)
+    , input_(std::move(other.input_)) {
+}
+
+QueryClient& QueryClient::operator=(QueryClient&& other) noexcept {
+    std::swap(fd_, other.fd_);
+    std::swap(next_request_id_, other.next_request_id_);
+    std::swap(input_, other.input_);
+    return *this;
+}
+
+QueryClient::~QueryClient() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+uint32_t QueryClient::Send(std::string_view query, DocumentStatus status) {
+    const uint32_t request_id = next_request_id_++;
+    std::string frame;
+    WriteQueryRequest(frame, {request_id, status, query});
+    for (size_t offset = 0; offset < frame.size();) {
+        const ssize_t sent = ::send(fd_, frame.data() + offset, frame.size() - offset, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("Ошибка отправки запроса");
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    return request_id;
+}
+
+QueryResponse QueryClient::Receive() {
+    while (true) {
+        std::string_view frame;
+        if (const size_t frame_size = ReadQueryFrame(input_, frame)) {
+            QueryResponse response = ParseQueryResponse(frame);
+            input_.erase(0, frame_size);
+            return response;
+        }
+        char buffer[64 * 1024];
+        const ssize_t received = ::recv(fd_, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            if (received == 0) {
+                throw std::runtime_error("Сервер закрыл соединение.");
+            }
+            ThrowSystemError("Ошибка чтения ответа");
+        }
+        input_.append(buffer, static_cast<size_t>(received));
+    }
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct ConnectionResult {
+    size_t errors {0};
+    LatencyRecorder latencies;
+    std::exception_ptr failure; // исключение потока пробрасывается после join
+};
+
+void RunLoadConnection(const LoadOptions& options, const std::vector<std::string>& queries, size_t connection,
+                       ConnectionResult& result) {
+    QueryClient client = options.unix_path.empty() ? QueryClient::ConnectTcp(options.port)
+                                                   : QueryClient::ConnectUnix(options.unix_path);
+    const size_t pipeline_depth = std::max<size_t>(1, options.pipeline_depth);
+    std::unordered_map<uint32_t, Clock::time_point> in_flight;
+    size_t next_query = connection; // соединения начинают с разных запросов
+    size_t sent = 0;
+    for (size_t received = 0; received < options.requests_per_connection; ++received) {
+        while (sent < options.requests_per_connection && in_flight.size() < pipeline_depth) {
+            const auto send_time = Clock::now();
+            in_flight.emplace(client.Send(queries[next_query++ % queries.size()]), send_time);
+            ++sent;
+        }
+        const QueryResponse response = client.Receive();
+        const auto it = in_flight.find(response.request_id);
+        if (it != in_flight.end()) {
+            result.latencies.Add(Clock::now() - it->second);
+            in_flight.erase(it);
+        }
+        result.errors += response.ok ? 0 : 1;
+    }
+}
+
+} // namespace
+
+LoadReport RunQueryLoad(const LoadOptions& options, const std::vector<std::string>& queries) {
+    if (queries.empty()) {
+        throw std::invalid_argument("Нет запросов для нагрузки.");
+    }
+    std::vector<ConnectionResult> results(options.connections);
+
+    const auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t connection = 0; connection < options.connections; ++connection) {
+        threads.emplace_back([&options, &queries, &result = results[connection], connection] {
+            try {
+                RunLoadConnection(options, queries, connection, result);
+            } catch (...) {
+                result.failure = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    LoadReport report;
+    report.elapsed = Clock::now() - start;
+    for (const ConnectionResult& result : results) {
+        if (result.failure) {
+            std::rethrow_exception(result.failure);
+        }
+        report.errors += result.errors;
+        report.latencies.Merge(result.latencies);
+    }
+    report.requests = report.latencies.GetCount();
+    return report;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "latency_recorder.h"
+#include "query_protocol.h"
+
+// Блокирующий клиент QueryServer. Запросы можно отправлять несколько подряд (конвейер),
+// ответы читаются по одному и сопоставляются по request_id.
+class QueryClient {
+public:
+    static QueryClient ConnectUnix(const std::string& path);
+    static QueryClient ConnectTcp(uint16_t port); // 127.0.0.1
+
+    QueryClient(QueryClient&& other) noexcept;
+    QueryClient& operator=(QueryClient&& other) noexcept;
+    ~QueryClient();
+
+    uint32_t Send(std::string_view query, DocumentStatus status = DocumentStatus::ACTUAL); // возвращает request_id
+    QueryResponse Receive();
+
+private:
+    explicit QueryClient(int fd);
+
+    int fd_ {-1};
+    uint32_t next_request_id_ {0};
+    std::string input_;
+};
+
+struct LoadOptions {
+    std::string unix_path;  // если пуст — TCP на 127.0.0.1:port
+    uint16_t port {0};
+    size_t connections {4}; // по потоку на соединение
+    size_t requests_per_connection {1'000};
+    size_t pipeline_depth {8}; // сколько запросов соединение держит без ответа
+};
+
+struct LoadReport {
+    size_t requests {0};
+    size_t errors {0};
+    std::chrono::duration<double> elapsed {0};
+    LatencyRecorder latencies;
+
+    double GetQps() const {
+        return elapsed.count() > 0 ? requests / elapsed.count() : 0.0;
+    }
+};
+
+// Закрытый цикл: каждое соединение держит pipeline_depth запросов в полёте, запросы берутся по кругу из queries
+LoadReport RunQueryLoad(const LoadOptions& options, const std::vector<std::string>& queries);
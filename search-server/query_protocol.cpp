@@ -0,0 +1,107 @@
+#include "query_protocol.h"
+#include "binary_io.h"
+
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t DOCUMENT_RECORD_SIZE {sizeof(int32_t) + sizeof(double) + sizeof(int32_t)};
+
+// заголовок длины дописывается после тела, когда его размер известен
+template <typename WriteBody>
+void WriteFrame(std::string& out, WriteBody write_body) {
+    const size_t header_offset = out.size();
+    WriteBinary(out, uint32_t {0});
+    write_body(out);
+    const uint32_t body_size = static_cast<uint32_t>(out.size() - header_offset - sizeof(uint32_t));
+    out.replace(header_offset, sizeof(body_size), reinterpret_cast<const char*>(&body_size), sizeof(body_size));
+}
+
+void RequireEnd(const BinaryReader& reader) {
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Лишние данные в кадре протокола.");
+    }
+}
+
+} // namespace
+
+void WriteQueryRequest(std::string& out, const QueryRequest& request) {
+    WriteFrame(out, [&request](std::string& body) {
+        WriteBinary(body, request.request_id);
+        WriteBinary(body, static_cast<uint8_t>(request.status));
+        WriteBinary(body, request.query);
+    });
+}
+
+void WriteQueryResponse(std::string& out, uint32_t request_id, std::span<const Document> documents) {
+    WriteFrame(out, [&](std::string& body) {
+        WriteBinary(body, request_id);
+        WriteBinary(body, uint8_t {1});
+        WriteBinary(body, static_cast<uint32_t>(documents.size()));
+        for (const Document& document : documents) {
+            WriteBinary(body, static_cast<int32_t>(document.id));
+            WriteBinary(body, document.relevance);
+            WriteBinary(body, static_cast<int32_t>(document.rating));
+        }
+    });
+}
+
+void WriteQueryErrorResponse(std::string& out, uint32_t request_id, std::string_view error) {
+    WriteFrame(out, [&](std::string& body) {
+        WriteBinary(body, request_id);
+        WriteBinary(body, uint8_t {0});
+        WriteBinary(body, error);
+    });
+}
+
+size_t ReadQueryFrame(std::string_view buffer, std::string_view& frame) {
+    if (buffer.size() < sizeof(uint32_t)) {
+        return 0;
+    }
+    const uint32_t body_size = BinaryReader(buffer).Read<uint32_t>();
+    if (body_size > MAX_QUERY_FRAME_SIZE) {
+        throw std::runtime_error("Слишком длинный кадр протокола.");
+    }
+    if (buffer.size() - sizeof(uint32_t) < body_size) {
+        return 0;
+    }
+    frame = buffer.substr(sizeof(uint32_t), body_size);
+    return sizeof(uint32_t) + body_size;
+}
+
+QueryRequest ParseQueryRequest(std::string_view frame) {
+    BinaryReader reader(frame);
+    QueryRequest request;
+    request.request_id = reader.Read<uint32_t>();
+    const uint8_t status = reader.Read<uint8_t>();
+    if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+        throw std::runtime_error("Неизвестный статус документа в запросе.");
+    }
+    request.status = static_cast<DocumentStatus>(status);
+    request.query = reader.ReadString();
+    RequireEnd(reader);
+    return request;
+}
+
+QueryResponse ParseQueryResponse(std::string_view frame) {
+    BinaryReader reader(frame);
+    QueryResponse response;
+    response.request_id = reader.Read<uint32_t>();
+    response.ok = reader.Read<uint8_t>() != 0;
+    if (response.ok) {
+        const uint32_t document_count = reader.Read<uint32_t>();
+        if (document_count > frame.size() / DOCUMENT_RECORD_SIZE) {
+            throw std::runtime_error("Неверное число документов в ответе.");
+        }
+        response.documents.resize(document_count);
+        for (Document& document : response.documents) {
+            document.id = reader.Read<int32_t>();
+            document.relevance = reader.Read<double>();
+            document.rating = reader.Read<int32_t>();
+        }
+    } else {
+        response.error = reader.ReadString();
+    }
+    RequireEnd(reader);
+    return response;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Протокол QueryServer: каждый кадр — длина (uint32) и тело такой длины, порядок байтов платформы (см. binary_io.h).
+// Запрос:  request_id (uint32), статус (uint8), текст запроса (uint32 длина + байты).
+// Ответ:   request_id (uint32), ok (uint8); при ok — число документов (uint32) и для каждого id (int32),
+//          relevance (double), rating (int32); иначе — текст ошибки.
+// Ответы по одному соединению приходят не обязательно в порядке запросов: сопоставляются по request_id.
+
+inline constexpr uint32_t MAX_QUERY_FRAME_SIZE {1 << 20};
+
+struct QueryRequest {
+    uint32_t request_id {0};
+    DocumentStatus status {DocumentStatus::ACTUAL};
+    std::string_view query;
+};
+
+struct QueryResponse {
+    uint32_t request_id {0};
+    bool ok {true};
+    std::vector<Document> documents;
+    std::string error;
+};
+
+void WriteQueryRequest(std::string& out, const QueryRequest& request);
+void WriteQueryResponse(std::string& out, uint32_t request_id, std::span<const Document> documents);
+void WriteQueryErrorResponse(std::string& out, uint32_t request_id, std::string_view error);
+
+// Если в начале buffer лежит целый кадр, кладёт его тело в frame и возвращает длину кадра с заголовком, иначе 0.
+// Кадр длиннее MAX_QUERY_FRAME_SIZE — std::runtime_error.
+size_t ReadQueryFrame(std::string_view buffer, std::string_view& frame);
+
+// тела кадров; при неверном формате — std::runtime_error
+QueryRequest ParseQueryRequest(std::string_view frame);
+QueryResponse ParseQueryResponse(std::string_view frame);
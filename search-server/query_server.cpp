@@ -0,0 +1,403 @@
+#include "query_server.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <execution>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// служебные метки событий epoll; соединения нумеруются после них
+constexpr uint64_t LISTEN_EVENT {0};
+constexpr uint64_t STOP_EVENT {1};
+constexpr uint64_t TIMER_EVENT {2};
+constexpr uint64_t COMPLETION_EVENT {3};
+constexpr uint64_t FIRST_CONNECTION_ID {4};
+
+constexpr size_t READ_CHUNK_SIZE {64 * 1024};
+
+void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void AddToEpoll(int epoll_fd, int fd, uint32_t events, uint64_t id) {
+    epoll_event event {};
+    event.events = events;
+    event.data.u64 = id;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        ThrowSystemError("epoll_ctl");
+    }
+}
+
+} // namespace
+
+QueryServer::QueryServer(const SearchServer& search_server, Options options)
+    : search_server_(search_server)
+    , options_(std::move(options))
+    , next_connection_id_(FIRST_CONNECTION_ID) {
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    completion_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || stop_fd_ < 0 || timer_fd_ < 0 || completion_fd_ < 0) {
+        ThrowSystemError("Не удалось создать дескрипторы цикла событий");
+    }
+    Listen();
+    AddToEpoll(epoll_fd_, listen_fd_, EPOLLIN, LISTEN_EVENT);
+    AddToEpoll(epoll_fd_, stop_fd_, EPOLLIN, STOP_EVENT);
+    AddToEpoll(epoll_fd_, timer_fd_, EPOLLIN, TIMER_EVENT);
+    AddToEpoll(epoll_fd_, completion_fd_, EPOLLIN, COMPLETION_EVENT);
+    executor_ = std::thread([this] { RunBatches(); });
+}
+
+QueryServer::~QueryServer() {
+    {
+        std::lock_guard guard(batches_mutex_);
+        shutting_down_ = true;
+    }
+    batches_changed_.notify_all();
+    executor_.join(); // отданные пакеты выполняются до конца, их ответы отбрасываются
+    for (const auto& [connection_id, connection] : connections_) {
+        ::close(connection.fd);
+    }
+    for (const int fd : {listen_fd_, timer_fd_, completion_fd_, stop_fd_, epoll_fd_}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (!options_.unix_path.empty()) {
+        ::unlink(options_.unix_path.c_str());
+    }
+}
+
+uint16_t QueryServer::GetPort() const {
+    return port_;
+}
+
+void QueryServer::Run() {
+    std::vector<epoll_event> events(64);
+    while (true) {
+        const int ready = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait");
+        }
+        bool batch_due = false;
+        for (int i = 0; i < ready; ++i) {
+            const uint64_t id = events[i].data.u64;
+            if (id == STOP_EVENT) {
+                // ответы на всё принятое дописываются в соединения, насколько они готовы принять без ожидания
+                if (!pending_.empty()) {
+                    SubmitBatch();
+                }
+                WaitForBatches();
+                WriteCompletions();
+                return;
+            }
+            if (id == LISTEN_EVENT) {
+                AcceptConnections();
+            } else if (id == COMPLETION_EVENT) {
+                WriteCompletions();
+            } else if (id == TIMER_EVENT) {
+                uint64_t expirations = 0;
+                [[maybe_unused]] const ssize_t result = ::read(timer_fd_, &expirations, sizeof(expirations));
+                batch_due = true;
+            } else if (connections_.count(id) > 0) { // могло закрыться на предыдущем событии
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    ReadConnection(id);
+                }
+                if ((events[i].events & EPOLLOUT) && connections_.count(id) > 0) {
+                    WriteConnection(id);
+                }
+            }
+        }
+        if (pending_.size() >= options_.max_batch_size || (batch_due && !pending_.empty())) {
+            SubmitBatch();
+        }
+    }
+}
+
+void QueryServer::Stop() {
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t result = ::write(stop_fd_, &one, sizeof(one));
+}
+
+QueryServer::Stats QueryServer::GetStats() const {
+    Stats stats;
+    stats.connections = connection_count_.load(std::memory_order_relaxed);
+    stats.requests = request_count_.load(std::memory_order_relaxed);
+    stats.batches = batch_count_.load(std::memory_order_relaxed);
+    stats.errors = error_count_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void QueryServer::Listen() {
+    if (!options_.unix_path.empty()) {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if (options_.unix_path.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Слишком длинный путь Unix-сокета.");
+        }
+        std::memcpy(address.sun_path, options_.unix_path.c_str(), options_.unix_path.size() + 1);
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        ::unlink(options_.unix_path.c_str());
+        if (listen_fd_ < 0 || ::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("Не удалось открыть " + options_.unix_path);
+        }
+    } else {
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(options_.port);
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int reuse = 1;
+        if (listen_fd_ < 0 || ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0
+            || ::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("Не удалось открыть порт " + std::to_string(options_.port));
+        }
+        socklen_t length = sizeof(address);
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+        port_ = ntohs(address.sin_port);
+    }
+    if (::listen(listen_fd_, SOMAXCONN) != 0) {
+        ThrowSystemError("listen");
+    }
+}
+
+void QueryServer::AcceptConnections() {
+    while (true) {
+        const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return; // EAGAIN: очередь принятия пуста; прочие ошибки относятся к одному клиенту
+        }
+        if (options_.unix_path.empty()) {
+            const int no_delay = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        }
+        const uint64_t connection_id = next_connection_id_++;
+        connections_[connection_id].fd = fd;
+        AddToEpoll(epoll_fd_, fd, EPOLLIN | EPOLLRDHUP, connection_id);
+        connection_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void QueryServer::ReadConnection(uint64_t connection_id) {
+    Connection& connection = connections_.at(connection_id);
+    bool closed = false;
+    while (true) {
+        const size_t old_size = connection.input.size();
+        connection.input.resize(old_size + READ_CHUNK_SIZE);
+        const ssize_t received = ::read(connection.fd, connection.input.data() + old_size, READ_CHUNK_SIZE);
+        connection.input.resize(old_size + std::max<ssize_t>(received, 0));
+        if (received > 0) {
+            continue;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        closed = received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+
+    const bool was_empty = pending_.empty();
+    size_t offset = 0;
+    try {
+        std::string_view frame;
+        while (const size_t frame_size = ReadQueryFrame(std::string_view(connection.input).substr(offset), frame)) {
+            const QueryRequest request = ParseQueryRequest(frame);
+            pending_.push_back({connection_id, request.request_id, request.status, std::string(request.query)});
+            request_count_.fetch_add(1, std::memory_order_relaxed);
+            offset += frame_size;
+        }
+    } catch (const std::runtime_error&) {
+        closed = true; // испорченный поток кадров не восстановить
+    }
+    connection.input.erase(0, offset);
+
+    if (was_empty && !pending_.empty()) {
+        ArmBatchTimer();
+    }
+    if (closed) {
+        CloseConnection(connection_id);
+    }
+}
+
+void QueryServer::WriteConnection(uint64_t connection_id) {
+    Connection& connection = connections_.at(connection_id);
+    while (connection.output_offset < connection.output.size()) {
+        const ssize_t sent = ::send(connection.fd, connection.output.data() + connection.output_offset,
+                                    connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            CloseConnection(connection_id);
+            return;
+        }
+        connection.output_offset += static_cast<size_t>(sent);
+    }
+    if (connection.output_offset == connection.output.size()) {
+        connection.output.clear();
+        connection.output_offset = 0;
+    }
+    UpdateInterest(connection_id, connection);
+}
+
+void QueryServer::CloseConnection(uint64_t connection_id) {
+    const auto it = connections_.find(connection_id);
+    if (it == connections_.end()) {
+        return;
+    }
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    ::close(it->second.fd);
+    connections_.erase(it); // ответы на его запросы из текущего пакета будут отброшены
+}
+
+void QueryServer::UpdateInterest(uint64_t connection_id, Connection& connection) {
+    const bool want_write = !connection.output.empty();
+    if (want_write == connection.want_write) {
+        return;
+    }
+    epoll_event event {};
+    event.events = EPOLLIN | EPOLLRDHUP | (want_write ? EPOLLOUT : 0u);
+    event.data.u64 = connection_id;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.want_write = want_write;
+}
+
+void QueryServer::ArmBatchTimer() {
+    const auto window = std::max(options_.batch_window, std::chrono::microseconds(1)); // нулевой interval выключает таймер
+    itimerspec timer {};
+    timer.it_value.tv_sec = window.count() / 1'000'000;
+    timer.it_value.tv_nsec = (window.count() % 1'000'000) * 1'000;
+    ::timerfd_settime(timer_fd_, 0, &timer, nullptr);
+}
+
+void QueryServer::SubmitBatch() {
+    const itimerspec disarmed {};
+    ::timerfd_settime(timer_fd_, 0, &disarmed, nullptr);
+    batch_count_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard guard(batches_mutex_);
+        batches_.push_back(std::move(pending_));
+    }
+    pending_.clear(); // после перемещения состояние вектора не определено
+    batches_changed_.notify_all();
+}
+
+void QueryServer::WaitForBatches() {
+    std::unique_lock lock(batches_mutex_);
+    batches_changed_.wait(lock, [this] { return batches_.empty() && !executing_; });
+}
+
+void QueryServer::WriteCompletions() {
+    // сначала сбрасываем eventfd, потом забираем ответы: ответ, добавленный между ними, разбудит цикл снова
+    uint64_t signals = 0;
+    [[maybe_unused]] const ssize_t result = ::read(completion_fd_, &signals, sizeof(signals));
+    std::vector<Completion> completions;
+    {
+        std::lock_guard guard(completions_mutex_);
+        completions.swap(completions_);
+    }
+
+    std::vector<uint64_t> touched;
+    for (Completion& completion : completions) {
+        const auto it = connections_.find(completion.connection_id);
+        if (it == connections_.end()) {
+            continue; // соединение закрылось, пока запрос выполнялся
+        }
+        it->second.output += completion.response;
+        if (completion.is_error) {
+            error_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+        touched.push_back(completion.connection_id);
+    }
+
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (const uint64_t connection_id : touched) {
+        if (connections_.count(connection_id) > 0) {
+            WriteConnection(connection_id);
+        }
+    }
+}
+
+void QueryServer::RunBatches() {
+    std::unique_lock lock(batches_mutex_);
+    while (true) {
+        batches_changed_.wait(lock, [this] { return shutting_down_ || !batches_.empty(); });
+        if (batches_.empty()) {
+            return;
+        }
+        const std::vector<PendingRequest> batch = std::move(batches_.front());
+        batches_.pop_front();
+        executing_ = true;
+        lock.unlock();
+        ExecuteBatch(batch);
+        lock.lock();
+        executing_ = false;
+        batches_changed_.notify_all();
+    }
+}
+
+void QueryServer::ExecuteBatch(const std::vector<PendingRequest>& batch) {
+    // номер запроса не выводится из адреса элемента: параллельный алгоритм вправе передать копию
+    std::vector<size_t> indexes(batch.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par,
+                  indexes.begin(), indexes.end(),
+                  [&](size_t index) {
+                      const PendingRequest& request = batch[index];
+                      Completion completion {request.connection_id, {}, false};
+                      // ошибка запроса становится ответом, а не исключением внутри параллельного алгоритма
+                      try {
+                          std::array<Document, MAX_RESULT_DOCUMENT_COUNT> documents;
+                          const size_t count = search_server_.FindTopDocuments(request.query, request.status,
+                                                                               std::span<Document>(documents));
+                          WriteQueryResponse(completion.response, request.request_id,
+                                             std::span<const Document>(documents.data(), count));
+                      } catch (const std::exception& e) {
+                          completion.response.clear();
+                          WriteQueryErrorResponse(completion.response, request.request_id, e.what());
+                          completion.is_error = true;
+                      }
+                      PostCompletion(std::move(completion));
+                  });
+}
+
+void QueryServer::PostCompletion(Completion completion) {
+    bool was_empty = false;
+    {
+        std::lock_guard guard(completions_mutex_);
+        was_empty = completions_.empty();
+        completions_.push_back(std::move(completion));
+    }
+    if (was_empty) { // в непустую очередь цикл уже разбужен
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t result = ::write(completion_fd_, &one, sizeof(one));
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "query_protocol.h"
+#include "search_server.h"
+
+// Сетевой вход в SearchServer на одном потоке с epoll: Unix-сокет или TCP на 127.0.0.1,
+// кадры протокола из query_protocol.h. Пришедшие запросы копятся в пакет, который отдаётся потоку-исполнителю,
+// когда заполнен или истекло окно batch_window с момента первого запроса пакета. Исполнитель выполняет пакет
+// как ProcessQueries (параллельно по запросам), а цикл событий тем временем принимает соединения и читает запросы.
+// Ответ каждого запроса возвращается в цикл через eventfd сразу по готовности и пишется в соединение,
+// не дожидаясь остальных запросов пакета. Пока Run работает, сервер поиска не должен меняться.
+class QueryServer {
+public:
+    struct Options {
+        std::string unix_path;   // если задан — слушаем Unix-сокет, иначе TCP
+        uint16_t port {0};       // 0 — любой свободный порт, см. GetPort
+        std::chrono::microseconds batch_window {500};
+        size_t max_batch_size {256};
+    };
+
+    struct Stats {
+        uint64_t connections {0};
+        uint64_t requests {0};
+        uint64_t batches {0};
+        uint64_t errors {0}; // запросы, на которые ответили ошибкой
+    };
+
+    QueryServer(const SearchServer& search_server, Options options);
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    uint16_t GetPort() const;
+
+    void Run();  // цикл событий до Stop
+    void Stop(); // можно звать из другого потока
+
+    Stats GetStats() const;
+
+private:
+    struct Connection {
+        int fd {-1};
+        std::string input;
+        std::string output;
+        size_t output_offset {0};
+        bool want_write {false};
+    };
+
+    struct PendingRequest {
+        uint64_t connection_id {0};
+        uint32_t request_id {0};
+        DocumentStatus status {DocumentStatus::ACTUAL};
+        std::string query;
+    };
+
+    // готовый ответ на запрос, переданный исполнителем в цикл
+    struct Completion {
+        uint64_t connection_id {0};
+        std::string response; // кадр ответа целиком
+        bool is_error {false};
+    };
+
+    void Listen();
+    void AcceptConnections();
+    void ReadConnection(uint64_t connection_id);
+    void WriteConnection(uint64_t connection_id);
+    void CloseConnection(uint64_t connection_id);
+    void UpdateInterest(uint64_t connection_id, Connection& connection);
+    void ArmBatchTimer();
+    void SubmitBatch();       // отдаёт pending_ исполнителю
+    void WaitForBatches();    // до выполнения всех отданных пакетов
+    void WriteCompletions();  // готовые ответы — в соединения
+
+    // поток исполнителя
+    void RunBatches();
+    void ExecuteBatch(const std::vector<PendingRequest>& batch);
+    void PostCompletion(Completion completion);
+
+    const SearchServer& search_server_;
+    Options options_;
+    int listen_fd_ {-1};
+    int epoll_fd_ {-1};
+    int stop_fd_ {-1};  // eventfd: будит цикл из Stop
+    int timer_fd_ {-1}; // timerfd: окно пакета
+    int completion_fd_ {-1}; // eventfd: будит цикл, когда в completions_ появились ответы
+    uint16_t port_ {0};
+
+    uint64_t next_connection_id_ {0};
+    std::unordered_map<uint64_t, Connection> connections_;
+    std::vector<PendingRequest> pending_;
+
+    std::mutex batches_mutex_;
+    std::condition_variable batches_changed_;
+    std::deque<std::vector<PendingRequest>> batches_; // отданы исполнителю, ещё не начаты
+    bool executing_ {false}; // исполнитель выполняет пакет
+    bool shutting_down_ {false};
+
+    std::mutex completions_mutex_;
+    std::vector<Completion> completions_;
+
+    std::atomic<uint64_t> connection_count_ {0};
+    std::atomic<uint64_t> request_count_ {0};
+    std::atomic<uint64_t> batch_count_ {0};
+    std::atomic<uint64_t> error_count_ {0};
+
+    std::thread executor_; // объявлен последним: запускается, когда остальные члены готовы
+};
@@ -0,0 +1,80 @@
+// Сервер запросов: индексирует файл документов (строка — документ, id — номер строки с нуля)
+// и отвечает на запросы по протоколу query_protocol.h до SIGINT/SIGTERM.
+//
+//   query-server --documents docs.txt [--stop-words "и в на"] (--unix /tmp/search.sock | --port 8080)
+//                [--batch-window-us 500] [--max-batch 256]
+
+#include "query_server.h"
+#include "read_input_functions.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+QueryServer* running_server = nullptr;
+
+void HandleSignal(int) {
+    if (running_server) {
+        running_server->Stop(); // write в eventfd допустим в обработчике сигнала
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    string documents_path;
+    string stop_words;
+    QueryServer::Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const string_view name = argv[i];
+        const string value = argv[i + 1];
+        if (name == "--documents"sv) {
+            documents_path = value;
+        } else if (name == "--stop-words"sv) {
+            stop_words = value;
+        } else if (name == "--unix"sv) {
+            options.unix_path = value;
+        } else if (name == "--port"sv) {
+            options.port = static_cast<uint16_t>(stoi(value));
+        } else if (name == "--batch-window-us"sv) {
+            options.batch_window = chrono::microseconds(stoll(value));
+        } else if (name == "--max-batch"sv) {
+            options.max_batch_size = stoul(value);
+        } else {
+            cerr << "Неизвестный параметр "sv << name << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (documents_path.empty()) {
+        cerr << "Нужен --documents FILE"sv << endl;
+        return EXIT_FAILURE;
+    }
+
+    const vector<string> texts = ReadFileLines(documents_path);
+    vector<SearchServer::DocumentSource> documents(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        documents[i].id = static_cast<int>(i);
+        documents[i].text = texts[i];
+    }
+    SearchServer search_server(stop_words);
+    search_server.AddDocuments(execution::par, documents);
+
+    QueryServer server(search_server, options);
+    running_server = &server;
+    signal(SIGINT, HandleSignal);
+    signal(SIGTERM, HandleSignal);
+    cerr << "Проиндексировано документов: "sv << search_server.GetDocumentCount() << ", слушаем "sv
+         << (options.unix_path.empty() ? "127.0.0.1:"s + to_string(server.GetPort()) : options.unix_path) << endl;
+    server.Run();
+
+    const QueryServer::Stats stats = server.GetStats();
+    cerr << "Запросов: "sv << stats.requests << ", пакетов: "sv << stats.batches << ", ошибок: "sv << stats.errors << endl;
+    return EXIT_SUCCESS;
+}
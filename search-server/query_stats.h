@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <type_traits>
+
+// Как выполнялся один запрос: что нашлось в индексе, сколько элементов списков id пройдено
+// и куда ушло время. Заполняется перегрузками FindTopDocuments и MatchDocument, принимающими QueryStats&.
+struct QueryStats {
+    size_t terms_resolved {0};          // слов запроса, найденных в индексе
+    size_t postings_scanned {0};        // пройденных элементов списков id (в MatchDocument — ноль: работает прямой индекс)
+    size_t documents_scored {0};        // документов, получивших вклад хотя бы одного слова
+    size_t excluded_by_minus_words {0};
+    size_t rejected_by_predicate {0};   // пройденных, но отвергнутых предикатом; сегмент статуса отсекается без обхода
+    size_t candidates_before_top {0};   // документов перед сортировкой и усечением до MAX_RESULT_DOCUMENT_COUNT
+    bool plan_from_cache {false};
+
+    std::chrono::nanoseconds parse_time {0};   // разбор запроса, план (или кэш), компиляция фильтра
+    std::chrono::nanoseconds scoring_time {0}; // обход списков id и минус-слов
+    std::chrono::nanoseconds ranking_time {0}; // добор нулевых, сортировка и усечение
+};
+
+// Подставляется во внутренние шаблоны поиска, когда статистика не нужна: обращения к счётчикам
+// стоят под if constexpr (COLLECTS_QUERY_STATS<Stats>) и в этом случае не компилируются вовсе.
+struct NoQueryStats {};
+
+template <typename Stats>
+inline constexpr bool COLLECTS_QUERY_STATS = std::is_same_v<Stats, QueryStats>;
@@ -1,6 +1,8 @@
 #include "read_input_functions.h"
 
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 std::string ReadLine() {
     std::string s;
@@ -14,3 +16,17 @@ int ReadLineWithNumber() {
     ReadLine();
     return result;
 }
+
+std::vector<std::string> ReadFileLines(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Не удалось открыть файл " + path);
+    }
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) {
+        if (!line.empty()) {
+            lines.push_back(std::move(line));
+        }
+    }
+    return lines;
+}
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 std::string ReadLine();
 
 int ReadLineWithNumber();
+
+// Непустые строки файла; если файл не открылся — std::runtime_error
+std::vector<std::string> ReadFileLines(const std::string& path);
@@ -1,29 +1,191 @@
 #include "request_queue.h"
 
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// потоки раздаются сегментам по кругу в порядке первого обращения
+size_t GetThreadIndex() {
+    static std::atomic<size_t> next_index {0};
+    thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+} // namespace
+
+RequestQueue::RequestQueue(const SearchServer& search_server, const Options& options)
+    : search_server_(search_server)
+    , options_(options)
+    , slot_duration_(options.slot_count > 0 ? Clock::duration(options.window) / static_cast<int64_t>(options.slot_count)
+                                              : Clock::duration::zero())
+    , created_(Clock::now())
+    , slow_queries_(options.slow_query_capacity) {
+    if (options.slot_count == 0 || options.shard_count == 0 || slot_duration_ <= Clock::duration::zero()) {
+        throw std::invalid_argument("Окно статистики, число слотов и сегментов должны быть положительными.");
+    }
+    shards_.reserve(options.shard_count);
+    for (size_t i = 0; i < options.shard_count; ++i) {
+        shards_.push_back(std::make_unique<Shard>(options.slot_count));
+    }
+}
+
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(result.size());
-    return result;
+    return ExecuteFindRequest(GetRequestClass(status), raw_query, status);
+}
+
+void RequestQueue::RecordRequest(RequestClass request_class, size_t result_count, Clock::duration latency,
+                                 Clock::time_point at) {
+    Shard& shard = *shards_[GetThreadIndex() % shards_.size()];
+    AddRequest(shard, result_count, at);
+
+    Slot* slot = GetSlot(shard, GetPeriod(at));
+    if (slot == nullptr) {
+        return;
+    }
+    ClassCounters& counters = slot->classes[static_cast<size_t>(request_class)];
+    counters.requests.fetch_add(1, std::memory_order_relaxed);
+    if (result_count == 0) {
+        counters.empty_results.fetch_add(1, std::memory_order_relaxed);
+    }
+    counters.GetLatencies().Record(std::chrono::duration_cast<LatencyHistogram::Duration>(latency));
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return no_results_requests_;
+    std::vector<uint64_t> requests;
+    requests.reserve(shards_.size() * min_in_day_);
+    for (const auto& shard : shards_) {
+        for (const auto& request : shard->recent_requests) {
+            if (const uint64_t value = request.load(std::memory_order_relaxed)) {
+                requests.push_back(value);
+            }
+        }
+    }
+    // каждый сегмент помнит не меньше своих последних min_in_day_ запросов, значит, и общие последние среди них
+    auto first = requests.begin();
+    if (requests.size() > static_cast<size_t>(min_in_day_)) {
+        first = requests.end() - min_in_day_;
+        std::nth_element(requests.begin(), first, requests.end());
+    }
+    return static_cast<int>(std::count_if(first, requests.end(), [](uint64_t value) { return value & 1; }));
+}
+
+RequestQueue::WindowStats RequestQueue::GetStats(RequestClass request_class, Clock::time_point at) const {
+    return CollectStats([request_class](size_t index) { return index == static_cast<size_t>(request_class); }, at);
+}
+
+RequestQueue::WindowStats RequestQueue::GetStats(Clock::time_point at) const {
+    return CollectStats([](size_t) { return true; }, at);
 }
 
+RequestQueue::RequestClass RequestQueue::GetRequestClass(DocumentStatus status) {
+    return static_cast<RequestClass>(static_cast<int>(status)); // первые классы повторяют DocumentStatus
+}
+
+const SlowQueryLog& RequestQueue::GetSlowQueryLog() const {
+    return slow_queries_;
+}
 
-void RequestQueue::AddRequest(int results_num) {
-    // новый запрос - новая секунда
-    ++current_time_;
-    // удаляем все результаты поиска, которые устарели
-    while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp) {
-        if (0 == requests_.front().results) {
-            --no_results_requests_;
+LatencyHistogram& RequestQueue::ClassCounters::GetLatencies() {
+    LatencyHistogram* current = latencies.load(std::memory_order_acquire);
+    if (current != nullptr) {
+        return *current;
+    }
+    auto created = std::make_unique<LatencyHistogram>();
+    if (latencies.compare_exchange_strong(current, created.get(), std::memory_order_acq_rel)) {
+        return *created.release();
+    }
+    return *current; // другой поток успел выделить раньше
+}
+
+int64_t RequestQueue::GetPeriod(Clock::time_point at) const {
+    return at.time_since_epoch() / slot_duration_;
+}
+
+RequestQueue::Slot* RequestQueue::GetSlot(Shard& shard, int64_t period) {
+    Slot& slot = shard.slots[static_cast<size_t>(period) % options_.slot_count];
+    if (slot.period.load(std::memory_order_acquire) == period) {
+        return &slot;
+    }
+    std::lock_guard guard(shard.rotation_mutex);
+    const int64_t slot_period = slot.period.load(std::memory_order_relaxed);
+    if (slot_period > period) {
+        return nullptr;
+    }
+    if (slot_period < period) {
+        for (ClassCounters& counters : slot.classes) {
+            counters.requests.store(0, std::memory_order_relaxed);
+            counters.empty_results.store(0, std::memory_order_relaxed);
+            if (LatencyHistogram* latencies = counters.latencies.load(std::memory_order_acquire)) {
+                latencies->Clear();
+            }
         }
-        requests_.pop_front();
+        slot.period.store(period, std::memory_order_release);
     }
-    // сохраняем новый результат поиска
-    requests_.push_back({current_time_, results_num});
-    if (0 == results_num) {
-        ++no_results_requests_;
+    return &slot;
+}
+
+void RequestQueue::AddRequest(Shard& shard, size_t results_num, Clock::time_point at) {
+    // новый запрос вытесняет самый старый запрос сегмента; общие счётчики не трогаются
+    const uint64_t index = shard.request_count.fetch_add(1, std::memory_order_relaxed) % min_in_day_;
+    const auto at_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(at.time_since_epoch()).count();
+    const uint64_t is_empty = results_num == 0 ? 1 : 0;
+    shard.recent_requests[index].store(static_cast<uint64_t>(std::max<int64_t>(at_ns, 1)) << 1 | is_empty,
+                                       std::memory_order_relaxed);
+}
+
+void RequestQueue::AddSlowQuery(const std::string& raw_query, size_t result_count, Clock::duration latency,
+                                Clock::time_point at, const QueryStats& stats) {
+    SlowQueryRecord record;
+    record.raw_query = raw_query;
+    for (const SearchServer::QueryTerm& term : search_server_.DescribeQuery(raw_query)) {
+        record.terms.push_back({std::string(term.word), term.is_minus, term.is_required, term.posting_size});
+    }
+    record.result_count = result_count;
+    record.latency = std::chrono::duration_cast<std::chrono::nanoseconds>(latency);
+    record.at = at;
+    record.stats = stats;
+    slow_queries_.Add(record);
+}
+
+template <typename ClassFilter>
+RequestQueue::WindowStats RequestQueue::CollectStats(ClassFilter in_class, Clock::time_point at) const {
+    const int64_t current = GetPeriod(at);
+    const int64_t oldest = current - static_cast<int64_t>(options_.slot_count) + 1;
+
+    WindowStats stats;
+    const auto latencies = std::make_unique<LatencyHistogram>();
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < options_.slot_count; ++i) {
+            const Slot& slot = shard->slots[i];
+            const int64_t period = slot.period.load(std::memory_order_acquire);
+            if (period < oldest || period > current) {
+                continue;
+            }
+            for (size_t class_index = 0; class_index < REQUEST_CLASS_COUNT; ++class_index) {
+                if (!in_class(class_index)) {
+                    continue;
+                }
+                const ClassCounters& counters = slot.classes[class_index];
+                stats.requests += counters.requests.load(std::memory_order_relaxed);
+                stats.empty_results += counters.empty_results.load(std::memory_order_relaxed);
+                if (const LatencyHistogram* slot_latencies = counters.latencies.load(std::memory_order_acquire)) {
+                    latencies->Merge(*slot_latencies);
+                }
+            }
+        }
     }
+
+    // текущий слот заполнен частично; в начале работы окно короче, чем с момента создания
+    const Clock::duration full_slots = slot_duration_ * static_cast<int64_t>(options_.slot_count - 1);
+    const Clock::duration current_slot = at.time_since_epoch() - slot_duration_ * current;
+    const Clock::duration covered = std::min(full_slots + current_slot, std::max(at - created_, Clock::duration(1)));
+    stats.qps = stats.requests / std::chrono::duration<double>(covered).count();
+    stats.empty_result_rate = stats.requests > 0 ? static_cast<double>(stats.empty_results) / stats.requests : 0.0;
+    stats.p50 = latencies->GetPercentile(50.0);
+    stats.p90 = latencies->GetPercentile(90.0);
+    stats.p99 = latencies->GetPercentile(99.0);
+    stats.p999 = latencies->GetPercentile(99.9);
+    stats.max = latencies->GetMax();
+    return stats;
 }
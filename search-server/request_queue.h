@@ -1,42 +1,178 @@
 #pragma once
 
-#include <deque>
-//#include <vector>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
 //#include <string> - в "document.h"
 
 #include "document.h"
+#include "latency_histogram.h"
 #include "search_server.h"
+#include "slow_query_log.h"
 
+// Обёртка над поиском, собирающая статистику запросов; вызывать можно из нескольких потоков.
+// Каждый поток пишет в свой сегмент, и на пути запроса нет общих блокировок — только атомарные инкременты.
+// Статистика считается по скользящему окну реального времени из slot_count слотов: устаревший слот
+// обнуляет первый запрос нового периода под мьютексом своего сегмента, раз в window / slot_count.
+// Запросы, попавшие на границу слотов одновременно с обнулением, могут быть потеряны.
 class RequestQueue {
 public:
+    using Clock = std::chrono::steady_clock;
+
+    // класс запроса в статистике: статус документов или произвольный предикат
+    enum class RequestClass {
+        ACTUAL,
+        IRRELEVANT,
+        BANNED,
+        REMOVED,
+        PREDICATE,
+    };
+    static constexpr size_t REQUEST_CLASS_COUNT = 5;
+
+    struct Options {
+        std::chrono::seconds window {60};
+        size_t slot_count {12}; // окно сдвигается шагами по window / slot_count
+        size_t shard_count {8};
+        // запросы AddFindRequest не быстрее порога попадают в журнал медленных запросов
+        // (ноль — все, nanoseconds::max() — журнал не ведётся)
+        std::chrono::nanoseconds slow_query_threshold {std::chrono::milliseconds(100)};
+        size_t slow_query_capacity {256};
+        // время по фазам в журнале: ещё четыре чтения часов на каждый запрос; при нулевом пороге меряется всегда
+        bool measure_query_phases {false};
+    };
+
+    struct WindowStats {
+        uint64_t requests {0};
+        uint64_t empty_results {0};
+        double qps {0.0};
+        double empty_result_rate {0.0};
+        LatencyHistogram::Duration p50 {0};
+        LatencyHistogram::Duration p90 {0};
+        LatencyHistogram::Duration p99 {0};
+        LatencyHistogram::Duration p999 {0};
+        LatencyHistogram::Duration max {0};
+    };
+
     explicit RequestQueue(const SearchServer& search_server)
-        : search_server_(search_server)
-        , no_results_requests_(0)
-        , current_time_(0) {}
+        : RequestQueue(search_server, Options{}) {}
+
+    RequestQueue(const SearchServer& search_server, const Options& options);
 
     // сделаем "обертки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-        const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-        AddRequest(result.size());
-        return result;
+        return ExecuteFindRequest(RequestClass::PREDICATE, raw_query, document_predicate);
     }
 
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
 
+    // учёт запроса, выполненного в обход AddFindRequest (например, сервером запросов)
+    void RecordRequest(RequestClass request_class, size_t result_count, Clock::duration latency,
+                       Clock::time_point at = Clock::now());
+
+    // сколько из последних 1440 запросов ничего не нашли; сегменты помнят свои последние запросы,
+    // и при чтении из них отбираются самые поздние по времени учёта
     int GetNoResultRequests() const;
 
+    // статистика окна, заканчивающегося в at: по классу запросов или по всем вместе
+    WindowStats GetStats(RequestClass request_class, Clock::time_point at = Clock::now()) const;
+    WindowStats GetStats(Clock::time_point at = Clock::now()) const;
+
+    static RequestClass GetRequestClass(DocumentStatus status);
+
+    const SlowQueryLog& GetSlowQueryLog() const;
+
 private:
-    struct QueryResult {
-        uint64_t timestamp {0};
-        int results {0};
+    struct ClassCounters {
+        ClassCounters() = default;
+        ClassCounters(const ClassCounters&) = delete;
+        ClassCounters& operator=(const ClassCounters&) = delete;
+        ~ClassCounters() {
+            delete latencies.load(std::memory_order_relaxed);
+        }
+
+        // гистограмма весит десятки килобайт, поэтому выделяется при первом запросе класса в слоте
+        // и дальше только обнуляется; nullptr — запросов этого класса в слоте ещё не было
+        LatencyHistogram& GetLatencies();
+
+        std::atomic<uint64_t> requests {0};
+        std::atomic<uint64_t> empty_results {0};
+        std::atomic<LatencyHistogram*> latencies {nullptr};
+    };
+
+    struct Slot {
+        std::atomic<int64_t> period {-1}; // номер периода длиной window / slot_count, к которому относятся счётчики
+        std::array<ClassCounters, REQUEST_CLASS_COUNT> classes;
+    };
+
+    static constexpr int min_in_day_ {1440};
+
+    // отдельное выделение на сегмент: сегменты разных потоков не делят строки кэша
+    struct Shard {
+        explicit Shard(size_t slot_count)
+            : slots(std::make_unique<Slot[]>(slot_count)) {}
+
+        std::mutex rotation_mutex;
+        std::unique_ptr<Slot[]> slots;
+
+        // кольцо последних запросов сегмента: время учёта в наносекундах, сдвинутое на бит, и флаг пустого ответа
+        // в младшем бите; ноль — ячейка ещё не заполнена
+        std::atomic<uint64_t> request_count {0};
+        std::array<std::atomic<uint64_t>, min_in_day_> recent_requests {};
     };
 
-    std::deque<QueryResult> requests_;
     const SearchServer& search_server_;
-    int no_results_requests_ {0};
-    uint64_t current_time_ {0};
-    const static int min_in_day_ {1440};
+    const Options options_;
+    const Clock::duration slot_duration_;
+    const Clock::time_point created_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    SlowQueryLog slow_queries_;
+
+    // Счётчики QueryStats — несколько инкрементов на элемент списка, поэтому собираются для каждого запроса,
+    // и запись журнала получает их от того самого медленного выполнения. Время по фазам — по measure_query_phases.
+    template <typename DocumentPredicate>
+    std::vector<Document> ExecuteFindRequest(RequestClass request_class, const std::string& raw_query,
+                                             DocumentPredicate document_predicate);
+
+    int64_t GetPeriod(Clock::time_point at) const;
 
-    void AddRequest(int results_num);
+    Slot* GetSlot(Shard& shard, int64_t period); // nullptr — период уже вытеснен из окна
+
+    static void AddRequest(Shard& shard, size_t results_num, Clock::time_point at);
+
+    // запрос разбирается заново, чтобы записать слова и длины их списков: это дешевле, чем собирать их для каждого запроса
+    void AddSlowQuery(const std::string& raw_query, size_t result_count, Clock::duration latency,
+                      Clock::time_point at, const QueryStats& stats);
+
+    // in_class(index) — учитывать ли класс с этим номером
+    template <typename ClassFilter>
+    WindowStats CollectStats(ClassFilter in_class, Clock::time_point at) const;
 };
+
+template <typename DocumentPredicate>
+std::vector<Document> RequestQueue::ExecuteFindRequest(RequestClass request_class, const std::string& raw_query,
+                                                       DocumentPredicate document_predicate) {
+    if (options_.slow_query_threshold == std::chrono::nanoseconds::max()) {
+        const auto start = Clock::now();
+        auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
+        const auto finish = Clock::now();
+        RecordRequest(request_class, result.size(), finish - start, finish);
+        return result;
+    }
+
+    const bool measure_phases = options_.measure_query_phases
+                                || options_.slow_query_threshold <= std::chrono::nanoseconds::zero();
+    QueryStats stats;
+    const auto start = Clock::now();
+    auto result = search_server_.FindTopDocuments(raw_query, document_predicate, stats, measure_phases);
+    const auto finish = Clock::now();
+    RecordRequest(request_class, result.size(), finish - start, finish);
+    if (finish - start >= options_.slow_query_threshold) {
+        AddSlowQuery(raw_query, result.size(), finish - start, finish, stats);
+    }
+    return result;
+}
@@ -0,0 +1,30 @@
+#include "scratch_arena.h"
+
+ScratchArena::ScratchArena()
+    : pool_(std::pmr::pool_options{0, LARGEST_POOLED_BLOCK})
+    , resource_(INITIAL_BLOCK_SIZE, &pool_) {
+}
+
+ScratchArena& ScratchArena::ForThisThread() {
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+ScratchArena::Scope::Scope() {
+    ++ForThisThread().depth_;
+}
+
+ScratchArena::Scope::~Scope() {
+    ScratchArena& arena = ForThisThread();
+    if (--arena.depth_ == 0) {
+        arena.resource_.release();
+    }
+}
+
+std::pmr::memory_resource* ScratchArena::GetResource() {
+    return &ForThisThread().resource_;
+}
+
+size_t ScratchArena::GetDepth() {
+    return ForThisThread().depth_;
+}
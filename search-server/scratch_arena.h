@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Память для временных структур запроса: разобранные слова, накопители релевантности, кандидаты.
+// У каждого потока своя арена: выделение — сдвиг указателя без блокировок, освобождение — разом
+// при закрытии запроса. Блоки, отданные при сбросе, остаются в пуле потока и достаются следующим запросам,
+// так что в установившемся режиме запрос не обращается к malloc за временными данными.
+// Выделять из арены может только её поток; результат, возвращаемый пользователю, в ней не размещается.
+class ScratchArena {
+public:
+    // Открывает запрос в текущем потоке. Арена сбрасывается при закрытии самого внешнего Scope:
+    // планировщик может выполнить чужой запрос внутри ожидания своего, и его память трогать нельзя.
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // память текущего запроса этого потока; должна использоваться только внутри Scope
+    static std::pmr::memory_resource* GetResource();
+
+    static size_t GetDepth(); // открытые Scope текущего потока
+
+private:
+    static constexpr size_t INITIAL_BLOCK_SIZE {16 * 1024};
+    static constexpr size_t LARGEST_POOLED_BLOCK {16 * 1024 * 1024}; // крупнее — напрямую из кучи
+
+    ScratchArena();
+
+    static ScratchArena& ForThisThread();
+
+    std::pmr::unsynchronized_pool_resource pool_; // хранит блоки арены между запросами
+    std::pmr::monotonic_buffer_resource resource_;
+    size_t depth_ {0};
+};
@@ -4,31 +4,66 @@ CONFIG -= app_bundle
 CONFIG -= qt
 
 SOURCES += \
+        async_search_server.cpp \
+        benchmark.cpp \
         document.cpp \
+        document_filter.cpp \
+        durable_search_server.cpp \
+        load_generator.cpp \
         main.cpp \
         #old_main.cpp \
         process_queries.cpp \
+        query_client.cpp \
+        query_protocol.cpp \
+        query_server.cpp \
         read_input_functions.cpp \
         remove_duplicates.cpp \
         request_queue.cpp \
+        scratch_arena.cpp \
         search_server.cpp \
+        slow_query_log.cpp \
         string_processing.cpp \
+        synthetic_data.cpp \
         test_example_functions.cpp \
-        unit_tests.cpp
+        trace.cpp \
+        unit_tests.cpp \
+        write_ahead_log.cpp
 
 HEADERS += \
+    async_search_server.h \
+    benchmark.h \
+    binary_io.h \
     concurrent_map.h \
     document.h \
+    document_filter.h \
+    durable_search_server.h \
+    execution_mode.h \
+    interleaved_task.h \
+    intersection.h \
+    latency_histogram.h \
+    latency_recorder.h \
+    load_generator.h \
     log_duration.h \
+    memory_accounting.h \
     paginator.h \
+    plan_cache.h \
     process_queries.h \
+    query_client.h \
+    query_protocol.h \
+    query_server.h \
+    query_stats.h \
     read_input_functions.h \
     remove_duplicates.h \
     request_queue.h \
+    scratch_arena.h \
     search_server.h \
+    slow_query_log.h \
     string_processing.h \
+    synthetic_data.h \
     test_example_functions.h \
-    unit_tests.h
+    trace.h \
+    unit_tests.h \
+    write_ahead_log.h
 
 LIBS += -ltbb \    #libtbb-dev — вспомогательная библиотека Thread Building Blocks от Intel для реализации параллельности.
         -lpthread
@@ -1,12 +1,87 @@
 #include "search_server.h"
 #include "log_duration.h" // матчинг и поиск топ
+#include "binary_io.h"
 
+#include <bit>
+#include <cstdint>
+#include <iterator>
 #include <numeric>
 #include <cmath>
+#include <sstream>
+#include <unordered_map>
 
 using namespace std::literals;
 
+    SearchServer::SearchServer(std::unique_ptr<MemoryResources> memory)
+        : memory_(std::move(memory))
+        , stop_words_(&memory_->terms)
+        , word_to_document_freqs_(&memory_->terms)
+        , words_freqs_by_documents_(&memory_->forward_index)
+        , documents_(&memory_->attributes)
+        , documents_ids_(&memory_->attributes)
+        , status_index_(&memory_->attributes)
+        , rating_index_(&memory_->attributes)
+        , document_rows_(&memory_->attributes)
+        , plan_cache_(&memory_->caches)
+        , posting_snapshots_(&memory_->caches) {
+    }
+
+    SearchServer::SearchServer(const SearchServer& other)
+        : SearchServer(std::make_unique<MemoryResources>(other.GetMemoryResource())) {
+        CopyIndexFrom(other);
+    }
+
+    SearchServer& SearchServer::operator=(const SearchServer& other) {
+        if (this == &other) {
+            return *this;
+        }
+        words_freqs_by_documents_.clear(); // ссылается на словарь, очищается первым
+        word_to_document_freqs_.clear();
+        stop_words_.clear();
+        documents_.clear();
+        documents_ids_.clear();
+        status_index_.clear();
+        rating_index_.clear();
+        document_rows_.clear();
+        plan_cache_.Clear();
+        posting_snapshots_.Clear();
+        CopyIndexFrom(other);
+        ++index_version_; // планы подготовленных запросов ссылаются на старый словарь
+        return *this;
+    }
+
+    void SearchServer::CopyIndexFrom(const SearchServer& other) {
+        stop_words_.insert(other.stop_words_.begin(), other.stop_words_.end());
+        for (const auto& [word, posting] : other.word_to_document_freqs_) {
+            GetOrCreatePosting(word)->second.insert(posting.begin(), posting.end());
+        }
+        for (const auto& [document_id, word_freqs] : other.words_freqs_by_documents_) {
+            auto& document_words = words_freqs_by_documents_[document_id];
+            for (const auto& [word, freq] : word_freqs) {
+                document_words.emplace_hint(document_words.end(), word_to_document_freqs_.find(word)->first, freq);
+            }
+        }
+        documents_.insert(other.documents_.begin(), other.documents_.end());
+        documents_ids_.insert(other.documents_ids_.begin(), other.documents_ids_.end());
+        status_index_.insert(other.status_index_.begin(), other.status_index_.end());
+        rating_index_.assign(other.rating_index_.begin(), other.rating_index_.end());
+        document_rows_.assign(other.document_rows_.begin(), other.document_rows_.end());
+        adaptive_thresholds_ = other.adaptive_thresholds_;
+        execution_paths_ = other.execution_paths_;
+    }
+
+    SearchServer::Dictionary::iterator SearchServer::GetOrCreatePosting(std::string_view word) {
+        auto pos = word_to_document_freqs_.find(word);
+        if (pos == word_to_document_freqs_.end()) {
+            pos = word_to_document_freqs_.emplace(std::piecewise_construct,
+                                                  std::forward_as_tuple(word),
+                                                  std::forward_as_tuple(&memory_->postings)).first;
+        }
+        return pos;
+    }
+
     void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+        TRACE_SCOPE("AddDocument");
         if (document_id < 0)
             throw std::invalid_argument("Попытка добавить документ с отрицательным id.");
         if (documents_.count(document_id) > 0)
@@ -18,55 +93,494 @@ using namespace std::literals;
         } // проверка
 
         const std::vector<std::string_view> words = SplitIntoWordsNoStop(document);
-        const double step = 1.0 / words.size();
         for (std::string_view word : words) {
             /*word_to_document_freqs_[std::string(word)][document_id] += step;
             words_freqs_by_documents_[document_id][std::string(word)] += step;*/
-            word_to_document_freqs_[std::string(word)][document_id] += step;
-
-            const auto pos = word_to_document_freqs_.find(word);
-            words_freqs_by_documents_[document_id][pos->first] += step;
+            const auto pos = GetOrCreatePosting(word);
+            ++pos->second[{status, document_id}];
+            ++words_freqs_by_documents_[document_id][pos->first];
         }
         // example: words = "hello little cat", частота слова cat для этого документа 1/3;(for TF)
         // map<string, map<int, double>> word_to_document_freqs_;
         // map<int, map<string, double>> words_freqs_by_documents_; - по id
-        documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
+        ++index_version_;
+        const int rating = ComputeAverageRating(ratings);
+        const auto document_pos = documents_.emplace(document_id, DocumentData{ rating, status, static_cast<TermCount>(words.size()) }).first;
         documents_ids_.insert(document_id);
+        InsertDocumentAttributes({status, document_id}, document_pos->second);
+    }
+
+    void SearchServer::AddDocuments(const std::vector<DocumentSource>& documents) {
+        InsertDocuments(documents, false);
+    }
+
+    void SearchServer::AddDocuments(std::execution::sequenced_policy, const std::vector<DocumentSource>& documents) {
+        InsertDocuments(documents, false);
+    }
+
+    void SearchServer::AddDocuments(std::execution::parallel_policy, const std::vector<DocumentSource>& documents) {
+        InsertDocuments(documents, true);
+    }
+
+    void SearchServer::InsertDocuments(const std::vector<DocumentSource>& documents, bool in_parallel) {
+        std::vector<int> ids;
+        ids.reserve(documents.size());
+        for (const DocumentSource& document : documents) {
+            if (document.id < 0)
+                throw std::invalid_argument("Попытка добавить документ с отрицательным id.");
+            if (documents_.count(document.id) > 0)
+                throw std::invalid_argument("Попытка добавить документ c id ранее добавленного документа.");
+            ids.push_back(document.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        if (std::adjacent_find(ids.begin(), ids.end()) != ids.end())
+            throw std::invalid_argument("Повторяющийся id в добавляемой пачке документов.");
+
+        // Разбор: слова без стоп-слов, отсортированные, с числом вхождений. Исключение из par-алгоритма
+        // завершило бы программу, поэтому недопустимый текст только помечается и проверяется после.
+        struct ParsedDocument {
+            std::vector<std::pair<std::string_view, TermCount>> words;
+            TermCount length {0};
+            bool is_valid {true};
+        };
+        const auto parse = [this](const DocumentSource& document) {
+            ParsedDocument parsed;
+            std::vector<std::string_view> words = SplitIntoWords(document.text);
+            parsed.is_valid = std::all_of(words.begin(), words.end(), IsValidWord);
+            words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word) { return IsStopWord(word); }),
+                        words.end());
+            parsed.length = static_cast<TermCount>(words.size());
+            std::sort(words.begin(), words.end());
+            for (std::string_view word : words) {
+                if (!parsed.words.empty() && parsed.words.back().first == word) {
+                    ++parsed.words.back().second;
+                } else {
+                    parsed.words.emplace_back(word, 1);
+                }
+            }
+            return parsed;
+        };
+        std::vector<ParsedDocument> parsed(documents.size());
+        if (in_parallel) {
+            std::transform(std::execution::par, documents.begin(), documents.end(), parsed.begin(), parse);
+        } else {
+            std::transform(documents.begin(), documents.end(), parsed.begin(), parse);
+        }
+        if (std::any_of(parsed.begin(), parsed.end(), [](const ParsedDocument& document) { return !document.is_valid; }))
+            throw std::invalid_argument("Наличие недопустимых символов (с кодами от 0 до 31) в тексте добавляемого документа.");
+
+        ++index_version_;
+        const ScratchArena::Scope scratch;
+        std::pmr::memory_resource* resource = ScratchArena::GetResource();
+
+        // документы по возрастанию ключа (статус, id): ключи в группах слов получаются отсортированными
+        std::pmr::vector<size_t> order(documents.size(), resource);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&documents](size_t lhs, size_t rhs) {
+            return PostingKey{documents[lhs].status, documents[lhs].id} < PostingKey{documents[rhs].status, documents[rhs].id};
+        });
+
+        struct TermGroup {
+            Dictionary::iterator word_pos;
+            std::pmr::vector<std::pair<PostingKey, TermCount>> postings;
+        };
+        std::pmr::vector<TermGroup> groups(resource);
+        std::pmr::unordered_map<const char*, size_t> group_by_word(resource);
+        for (const size_t i : order) {
+            if (parsed[i].words.empty()) {
+                continue; // как в AddDocument: у документа из стоп-слов нет записи в прямом индексе
+            }
+            const PostingKey key {documents[i].status, documents[i].id};
+            TermCounts& document_words = words_freqs_by_documents_[key.document_id];
+            for (const auto& [word, count] : parsed[i].words) {
+                const auto word_pos = GetOrCreatePosting(word);
+                document_words.emplace_hint(document_words.end(), word_pos->first, count);
+                const auto [group_pos, inserted] = group_by_word.emplace(word_pos->first.data(), groups.size());
+                if (inserted) {
+                    groups.push_back({word_pos, std::pmr::vector<std::pair<PostingKey, TermCount>>(resource)});
+                }
+                groups[group_pos->second].postings.emplace_back(key, count);
+            }
+        }
+
+        // разные группы — разные списки id
+        const auto insert_group = [](TermGroup& group) {
+            Posting& posting = group.word_pos->second;
+            auto hint = posting.lower_bound(group.postings.front().first);
+            for (const auto& [key, count] : group.postings) {
+                hint = std::next(posting.emplace_hint(hint, key, count));
+            }
+        };
+        if (in_parallel) {
+            std::for_each(std::execution::par, groups.begin(), groups.end(), insert_group);
+        } else {
+            std::for_each(groups.begin(), groups.end(), insert_group);
+        }
+
+        // рейтинги пачки сливаются с индексом за один проход вместо вставки по одному
+        const size_t rating_index_size = rating_index_.size();
+        for (size_t i = 0; i < documents.size(); ++i) {
+            const DocumentSource& document = documents[i];
+            const int rating = ComputeAverageRating(document.ratings);
+            const DocumentData& data = documents_.emplace(document.id, DocumentData{ rating, document.status, parsed[i].length })
+                    .first->second;
+            documents_ids_.insert(document.id);
+            status_index_.insert({document.status, document.id});
+            rating_index_.push_back({rating, {document.status, document.id}});
+            StoreDocumentRow(document.id, data);
+        }
+        const auto added_begin = rating_index_.begin() + static_cast<std::ptrdiff_t>(rating_index_size);
+        std::sort(added_begin, rating_index_.end());
+        std::inplace_merge(rating_index_.begin(), added_begin, rating_index_.end());
+    }
+
+    void SearchServer::UpdateDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+        const auto document_pos = documents_.find(document_id);
+        if (document_pos == documents_.end())
+            throw std::invalid_argument("Попытка обновить документ с несуществующим id.");
+        for (std::string_view word : SplitIntoWords(document)) {
+            if (!IsValidWord(word))
+                throw std::invalid_argument("Наличие недопустимых символов (с кодами от 0 до 31) в тексте обновляемого документа.");
+        } // проверка до изменений: при ошибке индекс остаётся прежним
+
+        const ScratchArena::Scope scratch;
+        std::pmr::map<std::string_view, TermCount> new_counts(ScratchArena::GetResource());
+        TermCount length = 0;
+        for (std::string_view word : SplitIntoWords(document, ScratchArena::GetResource())) {
+            if (!IsStopWord(word)) {
+                ++new_counts[word];
+                ++length;
+            }
+        }
+
+        ++index_version_;
+        const PostingKey old_key {document_pos->second.status, document_id};
+        const PostingKey new_key {status, document_id};
+
+        // слияние двух отсортированных наборов слов: старого (прямой индекс) и нового
+        TermCounts& document_words = words_freqs_by_documents_[document_id];
+        auto old_pos = document_words.begin();
+        auto new_pos = new_counts.begin();
+        while (old_pos != document_words.end() || new_pos != new_counts.end()) {
+            if (new_pos == new_counts.end() || (old_pos != document_words.end() && old_pos->first < new_pos->first)) {
+                // слово исчезло из документа; как и в RemoveDocument, строка словаря остаётся
+                word_to_document_freqs_.find(old_pos->first)->second.erase(old_key);
+                old_pos = document_words.erase(old_pos);
+            } else if (old_pos == document_words.end() || new_pos->first < old_pos->first) {
+                // новое слово
+                const auto word_pos = GetOrCreatePosting(new_pos->first);
+                word_pos->second.emplace(new_key, new_pos->second);
+                document_words.emplace_hint(old_pos, word_pos->first, new_pos->second);
+                ++new_pos;
+            } else {
+                if (old_key != new_key || old_pos->second != new_pos->second) {
+                    MovePosting(word_to_document_freqs_.find(old_pos->first)->second, old_key, new_key, new_pos->second);
+                    old_pos->second = new_pos->second;
+                }
+                ++old_pos;
+                ++new_pos;
+            }
+        }
+        if (document_words.empty()) {
+            words_freqs_by_documents_.erase(document_id); // как в AddDocument: у документа из стоп-слов нет записи
+        }
+
+        document_pos->second.length = length;
+        ReplaceDocumentAttributes(old_key, status, ComputeAverageRating(ratings));
+    }
+
+    void SearchServer::UpdateDocumentAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings) {
+        const auto document_pos = documents_.find(document_id);
+        if (document_pos == documents_.end())
+            throw std::invalid_argument("Попытка обновить документ с несуществующим id.");
+
+        ++index_version_;
+        const PostingKey old_key {document_pos->second.status, document_id};
+        const PostingKey new_key {status, document_id};
+        if (old_key != new_key) {
+            for (const auto& [word, count] : GetWordCounts(document_id)) {
+                MovePosting(word_to_document_freqs_.find(word)->second, old_key, new_key, count);
+            }
+        }
+        ReplaceDocumentAttributes(old_key, status, ComputeAverageRating(ratings));
     }
 
     std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
         return FindTopDocuments(std::execution::seq, raw_query, status);
     }
 
+    size_t SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, std::span<Document> out) const {
+        return FindTopDocuments(raw_query, StatusPredicate{status}, out);
+    }
+
+    std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                         const SearchCursor& after, size_t count) const {
+        return FindTopDocuments(raw_query, StatusPredicate{status}, after, count);
+    }
+
+    std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const SearchCursor& after,
+                                                         size_t count) const {
+        return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, after, count);
+    }
+
+    SearchServer::TimedResult SearchServer::FindTopDocumentsWithDeadline(std::string_view raw_query, DocumentStatus status,
+                                                                         std::chrono::steady_clock::time_point deadline) const {
+        return FindTopDocumentsWithDeadline(raw_query, StatusPredicate{status}, deadline);
+    }
+
+    std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                         QueryStats& stats, bool measure_phases) const {
+        return FindTopDocuments(raw_query, StatusPredicate{status}, stats, measure_phases);
+    }
+
+    std::vector<std::vector<Document>> SearchServer::FindTopDocumentsInterleaved(std::span<const std::string> raw_queries,
+                                                                                 size_t group_size) const {
+        std::vector<std::vector<Document>> results(raw_queries.size());
+        group_size = std::max<size_t>(1, group_size);
+        std::vector<InterleavedTask> tasks;
+        tasks.reserve(group_size);
+        for (size_t group_begin = 0; group_begin < raw_queries.size(); group_begin += group_size) {
+            // одна область на всю группу: корутины приостанавливаются внутри своих выделений
+            const ScratchArena::Scope scratch;
+            const size_t group_end = std::min(raw_queries.size(), group_begin + group_size);
+            tasks.clear();
+            for (size_t i = group_begin; i < group_end; ++i) {
+                tasks.push_back(FindTopDocumentsCoroutine(raw_queries[i], results[i]));
+            }
+            RunInterleaved(tasks);
+            tasks.clear(); // кадры корутин держат вектора из области, освобождаем их до её закрытия
+        }
+        return results;
+    }
+
+    namespace {
+
+    constexpr size_t CACHE_LINE_SIZE = 64;
+    // элементов списка id или документов, читаемых между двумя co_await: несколько строк кэша
+    constexpr size_t INTERLEAVED_BLOCK_SIZE = 16;
+
+    // запрашивает все строки кэша, на которых лежат элементы range
+    template <typename T>
+    void PrefetchRange(std::span<const T> range) {
+        if (range.empty()) {
+            return;
+        }
+        const auto begin = reinterpret_cast<std::uintptr_t>(range.data()) & ~(CACHE_LINE_SIZE - 1);
+        const auto end = reinterpret_cast<std::uintptr_t>(range.data() + range.size());
+        for (std::uintptr_t line = begin; line < end; line += CACHE_LINE_SIZE) {
+            __builtin_prefetch(reinterpret_cast<const void*>(line));
+        }
+    }
+
+    } // namespace
+
+    InterleavedTask SearchServer::FindTopDocumentsCoroutine(std::string_view raw_query, std::vector<Document>& result) const {
+        const auto plan = GetQueryPlan(raw_query);
+        const StatusPredicate predicate {DocumentStatus::ACTUAL};
+        std::pmr::memory_resource* scratch = ScratchArena::GetResource();
+        DocumentCandidates candidates(scratch);
+
+        if (plan->strategy == QueryStrategy::INTERSECTION) {
+            candidates = FindAllDocumentsConjunctive(*plan, predicate);
+        } else {
+            // Списки читаются из плоских копий кусками: кусок запрашивается prefetch, и пока он грузится,
+            // поток уступается другим запросам группы. Копии держатся до конца запроса, план их не хранит
+            std::pmr::vector<std::shared_ptr<const PostingEntries>> snapshots(scratch);
+
+            // (id, count * idf) по словам подряд; stable_sort по id сохраняет порядок сложения, как в FindAllDocuments
+            std::pmr::vector<std::pair<int, double>> contributions(scratch);
+            for (const PlannedTerm& term : plan->scoring_terms) {
+                const auto segment = GetSegment(*snapshots.emplace_back(GetPostingSnapshot(term)), predicate.status);
+                for (size_t block_begin = 0; block_begin < segment.size(); block_begin += INTERLEAVED_BLOCK_SIZE) {
+                    const auto block = segment.subspan(block_begin, std::min(INTERLEAVED_BLOCK_SIZE, segment.size() - block_begin));
+                    PrefetchRange(block);
+                    co_await std::suspend_always{};
+                    for (const auto& [key, term_count] : block) {
+                        contributions.emplace_back(key.document_id, term_count * term.inverse_document_freq);
+                    }
+                }
+            }
+            std::stable_sort(contributions.begin(), contributions.end(),
+                             [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+            std::pmr::vector<int> excluded(scratch);
+            for (const PlannedTerm& term : plan->minus_terms) {
+                const auto segment = GetSegment(*snapshots.emplace_back(GetPostingSnapshot(term)), predicate.status);
+                for (size_t block_begin = 0; block_begin < segment.size(); block_begin += INTERLEAVED_BLOCK_SIZE) {
+                    const auto block = segment.subspan(block_begin, std::min(INTERLEAVED_BLOCK_SIZE, segment.size() - block_begin));
+                    PrefetchRange(block);
+                    co_await std::suspend_always{};
+                    for (const auto& entry : block) {
+                        excluded.push_back(entry.first.document_id);
+                    }
+                }
+            }
+            std::sort(excluded.begin(), excluded.end());
+
+            // (id, sum count * idf) без минус-слов
+            std::pmr::vector<std::pair<int, double>> scores(scratch);
+            for (auto it = contributions.begin(); it != contributions.end();) {
+                const int document_id = it->first;
+                double weighted_count = 0.0;
+                for (; it != contributions.end() && it->first == document_id; ++it) {
+                    weighted_count += it->second;
+                }
+                if (!std::binary_search(excluded.begin(), excluded.end(), document_id)) {
+                    scores.emplace_back(document_id, weighted_count);
+                }
+            }
+
+            // строки документов тоже читаются кусками: адрес строки известен по id, MakeDocument находит её в кэше
+            candidates.reserve(scores.size());
+            for (size_t block_begin = 0; block_begin < scores.size(); block_begin += INTERLEAVED_BLOCK_SIZE) {
+                const size_t block_end = std::min(scores.size(), block_begin + INTERLEAVED_BLOCK_SIZE);
+                for (size_t i = block_begin; i < block_end; ++i) {
+                    if (const DocumentData* row = FindDocumentRow(scores[i].first)) {
+                        __builtin_prefetch(row);
+                    }
+                }
+                co_await std::suspend_always{};
+                for (size_t i = block_begin; i < block_end; ++i) {
+                    candidates.push_back(MakeDocument(scores[i].first, scores[i].second));
+                }
+            }
+        }
+        AddZeroRelevanceDocuments(*plan, predicate, candidates);
+        SortAndTruncate(std::execution::seq, candidates);
+        result.assign(candidates.begin(), candidates.end());
+    }
+
+    std::shared_ptr<const SearchServer::PostingEntries> SearchServer::GetPostingSnapshot(const PlannedTerm& term) const {
+        const std::pmr::string key(term.word, ScratchArena::GetResource());
+        auto snapshot = posting_snapshots_.Find(key, index_version_);
+        if (snapshot == nullptr) {
+            // копия живёт в памяти кэша и учитывается в GetMemoryStats
+            snapshot = std::allocate_shared<PostingEntries>(std::pmr::polymorphic_allocator<PostingEntries>(&memory_->caches),
+                                                            term.posting->begin(), term.posting->end());
+            posting_snapshots_.Insert(key, index_version_, snapshot);
+        }
+        return snapshot;
+    }
+
+    std::span<const SearchServer::PostingEntries::value_type> SearchServer::GetSegment(const PostingEntries& entries,
+                                                                                        DocumentStatus status) {
+        const auto less_key = [](const PostingEntries::value_type& entry, const PostingKey& key) { return entry.first < key; };
+        const auto begin = std::lower_bound(entries.begin(), entries.end(), GetSegmentBegin(status), less_key);
+        const auto end = std::lower_bound(begin, entries.end(), GetSegmentEnd(status), less_key);
+        return {begin, end};
+    }
+
+    void SearchServer::SelectPageAfter(const SearchCursor& after, size_t count, DocumentCandidates& documents) {
+        if (!after.IsStart()) {
+            documents.erase(std::remove_if(documents.begin(), documents.end(),
+                                           [&after](const Document& document) { return !after.Precedes(document); }),
+                            documents.end());
+        }
+        const size_t page_size = std::min(count, documents.size());
+        std::partial_sort(documents.begin(), documents.begin() + page_size, documents.end(), IsRankedBefore);
+        documents.resize(page_size);
+    }
+
+    std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const {
+        return FindTopDocuments(std::execution::seq, query, status);
+    }
+
+    SearchServer::PreparedQuery SearchServer::Prepare(std::string_view raw_query) const {
+        auto state = std::make_shared<PreparedQuery::State>();
+        state->text = std::string(raw_query);
+        state->query = ParseQuery(state->text);
+        state->server = this;
+        state->plan.store(std::make_shared<const QueryPlan>(BuildQueryPlan(state->query)));
+        return PreparedQuery(std::move(state));
+    }
+
+    std::shared_ptr<const SearchServer::QueryPlan> SearchServer::GetPreparedPlan(const PreparedQuery& query) const {
+        PreparedQuery::State& state = *query.state_;
+        if (state.server != this) {
+            throw std::invalid_argument("Подготовленный запрос относится к другому поисковому серверу.");
+        }
+        auto plan = state.plan.load();
+        if (plan->index_version != index_version_) {
+            plan = std::make_shared<const QueryPlan>(BuildQueryPlan(state.query));
+            state.plan.store(plan);
+        }
+        return plan;
+    }
+
     int SearchServer::GetDocumentCount() const {
         return static_cast<int>(documents_.size());
     }
 
     SearchServer::DataAfterMatching SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
-        const Query query = ParseQuery(raw_query);
-            std::vector<std::string_view> matched_words;
-            matched_words.reserve(query.plus_words.size() + query.minus_words.size());
+        const ScratchArena::Scope scratch;
+        return MatchQuery(ParseQuery(raw_query, ScratchArena::GetResource()), document_id);
+    }
 
-            for (std::string_view word : query.plus_words) {
-                const auto word_position = word_to_document_freqs_.find(word);
-                if (word_position == word_to_document_freqs_.cend())
-                    continue;
+    SearchServer::DataAfterMatching SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+        if (query.state_->server != this) {
+            throw std::invalid_argument("Подготовленный запрос относится к другому поисковому серверу.");
+        }
+        return MatchQuery(query.state_->query, document_id);
+    }
 
-                if (word_position->second.count(document_id))
-                    matched_words.push_back(word_position->first);
-            }
+    SearchServer::DataAfterMatching SearchServer::MatchDocument(std::string_view raw_query, int document_id,
+                                                                QueryStats& stats) const {
+        using Clock = std::chrono::steady_clock;
+        stats = QueryStats{};
+        const ScratchArena::Scope scratch;
 
-            for (std::string_view word : query.minus_words) {
-                const auto word_position = word_to_document_freqs_.find(word);
-                if (word_position == word_to_document_freqs_.cend())
-                    continue;
+        const auto parse_start = Clock::now();
+        const Query query = ParseQuery(raw_query, ScratchArena::GetResource());
+        const auto scoring_start = Clock::now();
+        DataAfterMatching result = MatchQuery(query, document_id, &stats);
+        stats.parse_time = scoring_start - parse_start;
+        stats.scoring_time = Clock::now() - scoring_start;
+        return result;
+    }
 
-                if (word_position->second.count(document_id)) {
-                    matched_words.clear();
-                    break;
-                }
+    template <typename Stats>
+    SearchServer::DataAfterMatching SearchServer::MatchQuery(const Query& query, int document_id,
+                                                             [[maybe_unused]] Stats* stats) const {
+        const DocumentStatus status = documents_.at(document_id).status;
+        // пересекаем слова запроса с прямым индексом документа: цена зависит от длины документа, а не от длины списков id
+        const auto& document_words = GetWordCounts(document_id);
+        if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+            // как в FindTopDocuments: слова запроса, которые есть в словаре индекса
+            for (const auto* words : {&query.plus_words, &query.minus_words}) {
+                stats->terms_resolved += static_cast<size_t>(std::count_if(words->begin(), words->end(),
+                    [this](std::string_view word) {
+                        const auto word_pos = word_to_document_freqs_.find(word);
+                        return word_pos != word_to_document_freqs_.end() && !word_pos->second.empty();
+                    }));
             }
-            return {matched_words, documents_.at(document_id).status};
+        }
+
+        bool has_minus_word = false;
+        ForEachIntersection(query.minus_words.begin(), query.minus_words.end(), document_words,
+                            [&has_minus_word](const auto&) { has_minus_word = true; });
+        if (has_minus_word) {
+            if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+                stats->excluded_by_minus_words = 1;
+            }
+            return {std::vector<std::string_view> {}, status};
+        }
+
+        size_t required_matched = 0;
+        ForEachIntersection(query.required_words.begin(), query.required_words.end(), document_words,
+                            [&required_matched](const auto&) { ++required_matched; });
+        if (required_matched != query.required_words.size()) {
+            return {std::vector<std::string_view> {}, status};
+        }
+
+        std::vector<std::string_view> matched_words;
+        matched_words.reserve(std::min(query.plus_words.size(), document_words.size()));
+        ForEachIntersection(query.plus_words.begin(), query.plus_words.end(), document_words,
+                            [&matched_words](const auto& word_freq) { matched_words.push_back(word_freq.first); });
+        if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+            stats->documents_scored = matched_words.empty() ? 0 : 1;
+        }
+
+        return {matched_words, status};
     }
 
     SearchServer::DataAfterMatching SearchServer::MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const {
@@ -75,39 +589,45 @@ using namespace std::literals;
     SearchServer::DataAfterMatching SearchServer::MatchDocument(std::execution::parallel_policy, std::string_view raw_query, int document_id) const {
         using namespace std::execution;
 
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        const ScratchArena::Scope scratch;
+        std::pmr::memory_resource* resource = ScratchArena::GetResource();
+        std::pmr::vector<std::string_view> plus_words(resource);
+        std::pmr::vector<std::string_view> minus_words(resource);
+        std::pmr::vector<std::string_view> required_words(resource);
 
-        for (std::string_view word : SplitIntoWords(raw_query)) {
+        for (std::string_view word : SplitIntoWords(raw_query, resource)) {
           const QueryWord query_word = ParseQueryWord(word);
           if (!query_word.is_stop) {
               if (query_word.is_minus) {
                   minus_words.push_back(query_word.data);
               } else {
                   plus_words.push_back(query_word.data);
+                  if (query_word.is_required) {
+                      required_words.push_back(query_word.data);
+                  }
               }
           }
         }
 
-        const auto ckeck_word = [this, document_id](std::string_view word) {
-            const auto pos = word_to_document_freqs_.find(word);
-            return pos != word_to_document_freqs_.end() && pos->second.count(document_id);
+        const DocumentStatus status = documents_.at(document_id).status;
+        const auto& document_words = GetWordCounts(document_id);
+
+        const auto ckeck_word = [&document_words](std::string_view word) {
+            return document_words.count(word) > 0;
         };
 
         //check minus
-        if (std::any_of(std::execution::par, minus_words.begin(), minus_words.end(), ckeck_word)) {
-            return {std::vector<std::string_view> {}, documents_.at(document_id).status};
+        if (std::any_of(std::execution::par, minus_words.begin(), minus_words.end(), ckeck_word)
+                || !std::all_of(std::execution::par, required_words.begin(), required_words.end(), ckeck_word)) {
+            return {std::vector<std::string_view> {}, status};
         }
 
-        //std::vector<std::string> matched_words(plus_words.size());
         std::vector<std::string_view> matched_words(plus_words.size());
 
         auto it_end_cpy =
               std::copy_if(std::execution::par, plus_words.begin(), plus_words.end(),
                           matched_words.begin(),
-                          [&ckeck_word](std::string_view word) {
-                               return ckeck_word(word);
-                          });
+                          ckeck_word);
 
         matched_words.resize(std::distance(matched_words.begin(), it_end_cpy));
 
@@ -116,8 +636,22 @@ using namespace std::literals;
         auto last = std::unique(std::execution::par, matched_words.begin(), matched_words.end());
         matched_words.erase(last, matched_words.end());
 
-        return {matched_words, documents_.at(document_id).status};
+        // отдаём слова, принадлежащие индексу, а не raw_query
+        std::transform(std::execution::par, matched_words.begin(), matched_words.end(), matched_words.begin(),
+                       [&document_words](std::string_view word) { return document_words.find(word)->first; });
+
+        return {matched_words, status};
+    }
+    SearchServer::DataAfterMatching SearchServer::MatchDocument(const AdaptivePolicy&, std::string_view raw_query, int document_id) const {
+        // параллельная версия выгодна только на очень длинных запросах: иначе дороже раздача задач
+        if (CountWords(raw_query) < adaptive_thresholds_.min_parallel_match_words) {
+            execution_paths_.Add(ExecutionPath::SEQUENTIAL);
+            return MatchDocument(raw_query, document_id);
+        }
+        execution_paths_.Add(ExecutionPath::WORD_PARALLEL);
+        return MatchDocument(std::execution::par, raw_query, document_id);
     }
+
     bool SearchServer::IsValidWord(std::string_view word) {
         // A valid word must not contain special characters
         return std::none_of(word.begin(), word.end(), [](char c) {
@@ -155,25 +689,36 @@ using namespace std::literals;
         if (text.size() > 1)
             if (text[1] == '-' && text[0] == '-')
                 throw std::invalid_argument("Наличие более чем одного минуса перед словами, которых не должно быть в искомых документах");
+        if (text == "+"s)
+            throw std::invalid_argument("Отсутствие текста после символа «плюс»: в поисковом запросе.");
+        if (text.size() > 1 && (text[0] == '-' || text[0] == '+') && (text[1] == '-' || text[1] == '+'))
+            throw std::invalid_argument("Слово запроса может начинаться только с одного символа «минус» или «плюс».");
        // проверка
         bool is_minus = false;
+        bool is_required = false;
         if (text[0] == '-') {
             is_minus = true;
             text = text.substr(1);
+        } else if (text[0] == '+') {
+            is_required = true; // +word — слово обязано быть в документе
+            text = text.substr(1);
         }
-        return { text, is_minus, IsStopWord(text) };
+        return { text, is_minus, is_required, IsStopWord(text) };
     }
 
 
-    SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
-        Query query;
-        for (std::string_view word : SplitIntoWords(text)) {
+    SearchServer::Query SearchServer::ParseQuery(std::string_view text, std::pmr::memory_resource* resource) const {
+        Query query(resource);
+        for (std::string_view word : SplitIntoWords(text, resource)) {
             const QueryWord query_word = ParseQueryWord(word);
             if (!query_word.is_stop) {
                 if (query_word.is_minus) {
                     query.minus_words.push_back(query_word.data);
                 } else {
                     query.plus_words.push_back(query_word.data);
+                    if (query_word.is_required) {
+                        query.required_words.push_back(query_word.data);
+                    }
                 }
             }
         }
@@ -184,16 +729,191 @@ using namespace std::literals;
         std::sort(query.minus_words.begin(), query.minus_words.end());
         query.minus_words.erase(std::unique(query.minus_words.begin(), query.minus_words.end()), query.minus_words.end());
 
+        std::sort(query.required_words.begin(), query.required_words.end());
+        query.required_words.erase(std::unique(query.required_words.begin(), query.required_words.end()), query.required_words.end());
 
         return query;
     } //разбиваем на +- слова
 
     double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-        return std::log(documents_.size() * 1.0 / word_to_document_freqs_.at(std::string(word)).size());
+        return std::log(documents_.size() * 1.0 / word_to_document_freqs_.find(word)->second.size());
     } // IDF
 
-    const std::map<std::string_view, double> &SearchServer::GetWordFrequencies(int index) const {
-        static const std::map<std::string_view, double> empty_map {};
+    std::pmr::string SearchServer::MakePlanKey(const Query& query, std::pmr::memory_resource* resource) {
+        std::pmr::string key(resource);
+        for (std::string_view word : query.required_words) {
+            key += '+';
+            key += word;
+            key += ' ';
+        }
+        for (std::string_view word : query.plus_words) {
+            key += word;
+            key += ' ';
+        }
+        for (std::string_view word : query.minus_words) {
+            key += '-';
+            key += word;
+            key += ' ';
+        }
+        return key;
+    }
+
+    SearchServer::QueryPlan SearchServer::BuildQueryPlan(const Query& query, std::pmr::memory_resource* resource) const {
+        QueryPlan plan(resource);
+        plan.index_version = index_version_;
+        const auto resolve = [this](std::string_view word) -> PlannedTerm {
+            const auto word_pos = word_to_document_freqs_.find(word);
+            if (word_pos == word_to_document_freqs_.end() || word_pos->second.empty()) {
+                return {};
+            }
+            return {word_pos->first, &word_pos->second, ComputeWordInverseDocumentFreq(word)};
+        };
+        const auto by_document_freq = [](const PlannedTerm& lhs, const PlannedTerm& rhs) {
+            return lhs.posting->size() < rhs.posting->size();
+        };
+
+        for (std::string_view word : query.required_words) {
+            const PlannedTerm term = resolve(word);
+            if (term.posting == nullptr) {
+                plan.is_empty = true;
+            } else if (term.inverse_document_freq > 0.0) {
+                plan.required_terms.push_back(term); // слово из всех документов ничего не ограничивает
+            }
+        }
+        for (std::string_view word : query.plus_words) {
+            const PlannedTerm term = resolve(word);
+            if (term.posting == nullptr) {
+                continue;
+            }
+            if (term.inverse_document_freq > 0.0) {
+                plan.scoring_terms.push_back(term);
+            } else {
+                plan.pruned_words.push_back(term.word);
+            }
+        }
+        for (std::string_view word : query.minus_words) {
+            const PlannedTerm term = resolve(word);
+            if (term.posting != nullptr) {
+                plan.minus_terms.push_back(term);
+            }
+        }
+
+        std::sort(plan.required_terms.begin(), plan.required_terms.end(), by_document_freq);
+        std::sort(plan.scoring_terms.begin(), plan.scoring_terms.end(), by_document_freq);
+        std::sort(plan.minus_terms.begin(), plan.minus_terms.end(), by_document_freq);
+
+        if (plan.is_empty || !plan.required_terms.empty()) {
+            plan.strategy = QueryStrategy::INTERSECTION;
+        } else if (!plan.pruned_words.empty()) {
+            plan.strategy = QueryStrategy::PRUNED;
+            plan.matches_all = true;
+        }
+        return plan;
+    }
+
+    std::shared_ptr<const SearchServer::QueryPlan> SearchServer::GetQueryPlan(std::string_view raw_query, bool* from_cache) const {
+        const Query query = ParseQuery(raw_query, ScratchArena::GetResource());
+        const std::pmr::string key = MakePlanKey(query, ScratchArena::GetResource());
+
+        auto plan = plan_cache_.Find(key, index_version_);
+        if (from_cache != nullptr) {
+            *from_cache = plan != nullptr;
+        }
+        if (plan == nullptr) {
+            // план и его списки живут в памяти кэша и учитываются в GetMemoryStats
+            plan = std::allocate_shared<QueryPlan>(std::pmr::polymorphic_allocator<QueryPlan>(&memory_->caches),
+                                                   BuildQueryPlan(query, &memory_->caches));
+            plan_cache_.Insert(key, index_version_, plan);
+        }
+        return plan;
+    }
+
+    std::string SearchServer::Explain(std::string_view raw_query) const {
+        const ScratchArena::Scope scratch;
+        bool from_cache = false;
+        const auto plan = GetQueryPlan(raw_query, &from_cache);
+
+        std::ostringstream out;
+        static const char* strategy_names[] = {"EXHAUSTIVE", "PRUNED", "INTERSECTION"};
+        out << "strategy: "sv << strategy_names[static_cast<int>(plan->strategy)] << '\n';
+        const auto print_terms = [&out](std::string_view title, const std::pmr::vector<PlannedTerm>& terms) {
+            out << title << ':';
+            for (const PlannedTerm& term : terms) {
+                out << ' ' << term.word << " (df = "sv << term.posting->size() << ", idf = "sv << term.inverse_document_freq << ')';
+            }
+            out << '\n';
+        };
+        print_terms("required"sv, plan->required_terms);
+        print_terms("scoring"sv, plan->scoring_terms);
+        print_terms("minus"sv, plan->minus_terms);
+        out << "pruned (idf = 0):"sv;
+        for (std::string_view word : plan->pruned_words) {
+            out << ' ' << word;
+        }
+        out << '\n';
+        if (plan->is_empty) {
+            out << "empty: required word is not indexed\n"sv;
+        }
+        out << "cached: "sv << (from_cache ? "yes"sv : "no"sv) << '\n';
+        return out.str();
+    }
+
+    std::vector<SearchServer::QueryTerm> SearchServer::DescribeQuery(std::string_view raw_query) const {
+        const ScratchArena::Scope scratch;
+        const Query query = ParseQuery(raw_query, ScratchArena::GetResource());
+        const auto posting_size = [this](std::string_view word) -> size_t {
+            const auto word_pos = word_to_document_freqs_.find(word);
+            return word_pos == word_to_document_freqs_.end() ? 0 : word_pos->second.size();
+        };
+
+        std::vector<QueryTerm> terms;
+        terms.reserve(query.plus_words.size() + query.minus_words.size());
+        for (std::string_view word : query.plus_words) {
+            const bool is_required = std::binary_search(query.required_words.begin(), query.required_words.end(), word);
+            terms.push_back({word, false, is_required, posting_size(word)});
+        }
+        for (std::string_view word : query.minus_words) {
+            terms.push_back({word, true, false, posting_size(word)});
+        }
+        return terms;
+    }
+
+    ExecutionPath SearchServer::ChooseExecutionPath(const QueryPlan& plan) const {
+        if (plan.strategy == QueryStrategy::INTERSECTION) {
+            return ExecutionPath::SEQUENTIAL; // пересечение ограничено самым коротким списком, делить нечего
+        }
+        size_t total_postings = 0;
+        size_t longest_posting = 0;
+        for (const PlannedTerm& term : plan.scoring_terms) {
+            total_postings += term.posting->size();
+            longest_posting = std::max(longest_posting, term.posting->size());
+        }
+
+        if (total_postings < adaptive_thresholds_.min_parallel_postings) {
+            return ExecutionPath::SEQUENTIAL;
+        }
+        // по словам делим, только если слов много и ни один список не забирает больше половины работы
+        if (plan.scoring_terms.size() >= adaptive_thresholds_.min_word_parallel_words && longest_posting * 2 <= total_postings) {
+            return ExecutionPath::WORD_PARALLEL;
+        }
+        return ExecutionPath::RANGE_PARALLEL;
+    }
+
+    std::map<std::string_view, double> SearchServer::GetWordFrequencies(int index) const {
+        std::map<std::string_view, double> word_freqs;
+        const auto document_pos = documents_.find(index);
+        if (document_pos == documents_.end()) {
+            return word_freqs;
+        }
+        const double length = document_pos->second.length;
+        for (const auto& [word, count] : GetWordCounts(index)) {
+            word_freqs.emplace_hint(word_freqs.end(), word, count / length);
+        }
+        return word_freqs;
+    }
+
+    const SearchServer::TermCounts& SearchServer::GetWordCounts(int index) const {
+        static const TermCounts empty_map {};
 
         if (words_freqs_by_documents_.count(index) > 0)
             return words_freqs_by_documents_.at(index);
@@ -201,18 +921,25 @@ using namespace std::literals;
         return empty_map;
     }
 
+    Document SearchServer::MakeDocument(int document_id, double weighted_count) const {
+        const DocumentData& document = GetDocumentData(document_id);
+        return {document_id, weighted_count / document.length, document.rating};
+    }
+
     void SearchServer::RemoveDocument(int index) {
         auto it_doc_pos = documents_ids_.find(index);
 
         if (it_doc_pos == documents_ids_.end())
             return;
+        ++index_version_;
+        const PostingKey key {documents_.at(index).status, index};
         // map<int, map<string, double>> words_freqs_by_documents_ -> word : string
-        for (const auto& [word, _] : words_freqs_by_documents_.at(index)) {
-            // map<string, map<int, double>> word_to_document_freqs_ -> (erase - int)
-
-            word_to_document_freqs_.at(std::string(word)).erase(index);
+        for (const auto& [word, _] : GetWordCounts(index)) {
+            // word_to_document_freqs_ -> (erase - (статус, id))
+            word_to_document_freqs_.find(word)->second.erase(key);
         }
 
+        EraseDocumentAttributes(key);
         documents_ids_.erase(it_doc_pos);
         documents_.erase(index);
         words_freqs_by_documents_.erase(index);
@@ -239,9 +966,10 @@ using namespace std::literals;
         auto it_doc_pos = documents_ids_.find(index);
         if (it_doc_pos == documents_ids_.end())
             return;
+        ++index_version_;
 
-
-        auto& words_freqs = words_freqs_by_documents_.at(index);
+        const PostingKey key {documents_.at(index).status, index};
+        const auto& words_freqs = GetWordCounts(index);
         std::vector<const std::string_view*>  p_strs(words_freqs.size());
 
         std::transform(std::execution::par,
@@ -254,27 +982,444 @@ using namespace std::literals;
         std::for_each(std::execution::par,
                       p_strs.begin(), p_strs.end(),
                       [&](const auto& ptr_word) {
-                            word_to_document_freqs_.at(std::string(*ptr_word)).erase(index);
+                            word_to_document_freqs_.find(*ptr_word)->second.erase(key);
                         });
 
+        EraseDocumentAttributes(key);
         documents_ids_.erase(it_doc_pos);
         documents_.erase(index);
         words_freqs_by_documents_.erase(index);
     }
 
-    std::set<int>::iterator SearchServer::begin() {
+    void SearchServer::RemoveDocument(const AdaptivePolicy&, int index) {
+        if (GetWordCounts(index).size() < adaptive_thresholds_.min_parallel_remove_words) {
+            execution_paths_.Add(ExecutionPath::SEQUENTIAL);
+            RemoveDocument(index);
+        } else {
+            execution_paths_.Add(ExecutionPath::WORD_PARALLEL);
+            RemoveDocument(std::execution::par, index);
+        }
+    }
+
+    void SearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+        EraseDocuments(document_ids, false);
+    }
+
+    void SearchServer::RemoveDocuments(std::execution::sequenced_policy, const std::vector<int>& document_ids) {
+        EraseDocuments(document_ids, false);
+    }
+
+    void SearchServer::RemoveDocuments(std::execution::parallel_policy, const std::vector<int>& document_ids) {
+        EraseDocuments(document_ids, true);
+    }
+
+    void SearchServer::RemoveDocuments(const AdaptivePolicy&, const std::vector<int>& document_ids) {
+        size_t total_words = 0;
+        for (const int document_id : document_ids) {
+            total_words += GetWordCounts(document_id).size();
+        }
+        const bool in_parallel = total_words >= adaptive_thresholds_.min_parallel_remove_words;
+        execution_paths_.Add(in_parallel ? ExecutionPath::WORD_PARALLEL : ExecutionPath::SEQUENTIAL);
+        EraseDocuments(document_ids, in_parallel);
+    }
+
+    void SearchServer::EraseDocuments(const std::vector<int>& document_ids, bool in_parallel) {
+        const ScratchArena::Scope scratch;
+        std::pmr::memory_resource* resource = ScratchArena::GetResource();
+
+        std::pmr::vector<PostingKey> keys(resource);
+        keys.reserve(document_ids.size());
+        for (const int document_id : document_ids) {
+            const auto document_pos = documents_.find(document_id);
+            if (document_pos != documents_.end()) {
+                keys.push_back({document_pos->second.status, document_id});
+            }
+        }
+        if (keys.empty()) {
+            return;
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        ++index_version_;
+
+        // Группа на каждое затронутое слово; документы добавляются по возрастанию ключа, поэтому keys отсортированы.
+        // Слова прямого индекса указывают на строки словаря, так что адрес строки однозначно задаёт слово
+        // и словарь ищется один раз на слово, а не на пару (документ, слово).
+        struct TermGroup {
+            Dictionary::iterator word_pos;
+            std::pmr::vector<PostingKey> keys;
+        };
+        std::pmr::vector<TermGroup> groups(resource);
+        std::pmr::unordered_map<const char*, size_t> group_by_word(resource);
+        for (const PostingKey& key : keys) {
+            for (const auto& [word, _] : GetWordCounts(key.document_id)) {
+                const auto [group_pos, inserted] = group_by_word.emplace(word.data(), groups.size());
+                if (inserted) {
+                    groups.push_back({word_to_document_freqs_.find(word), std::pmr::vector<PostingKey>(resource)});
+                }
+                groups[group_pos->second].keys.push_back(key);
+            }
+        }
+
+        // разные группы — разные списки, их можно чистить независимо
+        const auto erase_group = [](TermGroup& group) {
+            ErasePostings(group.word_pos->second, group.keys);
+        };
+        if (in_parallel) {
+            std::for_each(std::execution::par, groups.begin(), groups.end(), erase_group);
+        } else {
+            std::for_each(groups.begin(), groups.end(), erase_group);
+        }
+
+        EraseDocumentsAttributes(keys);
+        for (const PostingKey& key : keys) {
+            documents_ids_.erase(key.document_id);
+            documents_.erase(key.document_id);
+            words_freqs_by_documents_.erase(key.document_id);
+        }
+    }
+
+    void SearchServer::ErasePostings(Posting& posting, const std::pmr::vector<PostingKey>& keys) {
+        // как в ForEachIntersection: немного ключей ищем в дереве, много — сливаем со списком
+        if (keys.size() * std::bit_width(posting.size()) < keys.size() + posting.size()) {
+            for (const PostingKey& key : keys) {
+                posting.erase(key);
+            }
+            return;
+        }
+        auto key_it = keys.begin();
+        auto pos = posting.lower_bound(*key_it);
+        while (pos != posting.end() && key_it != keys.end()) {
+            if (pos->first < *key_it) {
+                ++pos;
+            } else if (*key_it < pos->first) {
+                ++key_it;
+            } else {
+                pos = posting.erase(pos);
+                ++key_it;
+            }
+        }
+    }
+
+    void SearchServer::InsertDocumentAttributes(const PostingKey& key, const DocumentData& document) {
+        status_index_.insert(key);
+        const std::pair<int, PostingKey> entry {document.rating, key};
+        rating_index_.insert(std::upper_bound(rating_index_.begin(), rating_index_.end(), entry), entry);
+        StoreDocumentRow(key.document_id, document);
+    }
+
+    void SearchServer::EraseDocumentAttributes(const PostingKey& key) {
+        status_index_.erase(key);
+        const std::pair<int, PostingKey> entry {documents_.at(key.document_id).rating, key};
+        rating_index_.erase(std::lower_bound(rating_index_.begin(), rating_index_.end(), entry));
+        ReleaseEmptyRatingIndexes();
+    }
+
+    void SearchServer::EraseDocumentsAttributes(const std::pmr::vector<PostingKey>& keys) {
+        for (const PostingKey& key : keys) {
+            status_index_.erase(key);
+        }
+        rating_index_.erase(std::remove_if(rating_index_.begin(), rating_index_.end(),
+                                           [&keys](const std::pair<int, PostingKey>& entry) {
+                                               return std::binary_search(keys.begin(), keys.end(), entry.second);
+                                           }),
+                            rating_index_.end());
+        ReleaseEmptyRatingIndexes();
+    }
+
+    void SearchServer::ReleaseEmptyRatingIndexes() {
+        // как и деревья остальных таблиц, пустые векторы не держат память
+        if (rating_index_.empty()) {
+            rating_index_.shrink_to_fit();
+            document_rows_.clear();
+            document_rows_.shrink_to_fit();
+        }
+    }
+
+    void SearchServer::ReplaceDocumentAttributes(const PostingKey& old_key, DocumentStatus status, int rating) {
+        DocumentData& document = documents_.at(old_key.document_id);
+        const PostingKey new_key {status, old_key.document_id};
+
+        if (old_key != new_key) {
+            auto node = status_index_.extract(old_key);
+            node.value() = new_key;
+            status_index_.insert(std::move(node));
+        }
+        if (old_key != new_key || document.rating != rating) {
+            const std::pair<int, PostingKey> old_entry {document.rating, old_key};
+            rating_index_.erase(std::lower_bound(rating_index_.begin(), rating_index_.end(), old_entry));
+            const std::pair<int, PostingKey> new_entry {rating, new_key};
+            rating_index_.insert(std::upper_bound(rating_index_.begin(), rating_index_.end(), new_entry), new_entry);
+        }
+        document.status = status;
+        document.rating = rating;
+        StoreDocumentRow(old_key.document_id, document);
+    }
+
+    void SearchServer::StoreDocumentRow(int document_id, const DocumentData& document) {
+        const size_t index = static_cast<size_t>(document_id);
+        if (index >= document_rows_.size()) {
+            // Редкие большие id не раздувают массив: он растёт, только пока id не больше удвоенного числа документов
+            // (с запасом для маленьких индексов). Документы, добавленные раньше с id из нового куска, дописываются.
+            constexpr size_t min_dense_size = 4'096;
+            if (index >= std::max(2 * documents_.size(), min_dense_size)) {
+                return;
+            }
+            const size_t old_size = document_rows_.size();
+            document_rows_.resize(std::max(index + 1, 2 * old_size));
+            const auto end = documents_.lower_bound(static_cast<int>(document_rows_.size()));
+            for (auto it = documents_.lower_bound(static_cast<int>(old_size)); it != end; ++it) {
+                document_rows_[it->first] = it->second;
+            }
+        }
+        document_rows_[index] = document;
+    }
+
+    void SearchServer::MovePosting(Posting& posting, const PostingKey& old_key, const PostingKey& new_key, TermCount count) {
+        if (old_key == new_key) {
+            posting.find(old_key)->second = count;
+            return;
+        }
+        // узел переносится в сегмент нового статуса без освобождения и выделения памяти
+        auto node = posting.extract(old_key);
+        node.key() = new_key;
+        node.mapped() = count;
+        posting.insert(std::move(node));
+    }
+
+    SearchServer::PostingKey SearchServer::GetSegmentBegin(DocumentStatus status) {
+        return {status, std::numeric_limits<int>::min()};
+    }
+
+    SearchServer::PostingKey SearchServer::GetSegmentEnd(DocumentStatus status) {
+        return {static_cast<DocumentStatus>(static_cast<int>(status) + 1), std::numeric_limits<int>::min()};
+    }
+
+    SearchServer::CompiledFilter SearchServer::CompileFilter(std::shared_ptr<const DocumentFilter::Node> root) const {
+        CompiledFilter filter;
+        filter.status_mask = GetFilterStatusMask(*root);
+        filter.probes_rating = FilterProbesRating(*root);
+
+        // множество строится только из явных id и узких диапазонов рейтинга, оно не больше доли документов
+        if (auto candidates = GetFilterCandidates(*root)) {
+            filter.has_candidates = true;
+            filter.candidates = std::move(*candidates);
+            const auto rejected = [this, &root](const PostingKey& key) {
+                return !DocumentFilter::Evaluate(*root, key.document_id, key.status, GetDocumentRating(key.document_id));
+            };
+            filter.candidates.erase(std::remove_if(filter.candidates.begin(), filter.candidates.end(), rejected),
+                                    filter.candidates.end());
+        }
+        filter.root = std::move(root);
+        return filter;
+    }
+
+    uint8_t SearchServer::GetFilterStatusMask(const DocumentFilter::Node& node) {
+        using Kind = DocumentFilter::Kind;
+        constexpr uint8_t all_statuses = (1u << (static_cast<int>(DocumentStatus::REMOVED) + 1)) - 1;
+
+        switch (node.kind) {
+        case Kind::STATUS_IN: {
+            uint8_t mask = 0;
+            for (const DocumentStatus status : node.statuses) {
+                mask |= 1u << static_cast<int>(status);
+            }
+            return mask;
+        }
+        case Kind::AND:
+            return GetFilterStatusMask(*node.lhs) & GetFilterStatusMask(*node.rhs);
+        case Kind::OR:
+            return GetFilterStatusMask(*node.lhs) | GetFilterStatusMask(*node.rhs);
+        case Kind::NOT:
+            // точное дополнение известно только для чистого фильтра по статусу
+            if (node.lhs->kind == Kind::STATUS_IN) {
+                return all_statuses & ~GetFilterStatusMask(*node.lhs);
+            }
+            return all_statuses;
+        case Kind::RATING_BETWEEN:
+        case Kind::ID_IN:
+            return all_statuses;
+        }
+        return all_statuses;
+    }
+
+    bool SearchServer::FilterProbesRating(const DocumentFilter::Node& node) {
+        using Kind = DocumentFilter::Kind;
+        switch (node.kind) {
+        case Kind::RATING_BETWEEN:
+            return true;
+        case Kind::AND:
+        case Kind::OR:
+            return FilterProbesRating(*node.lhs) || FilterProbesRating(*node.rhs);
+        case Kind::NOT:
+            return FilterProbesRating(*node.lhs);
+        case Kind::STATUS_IN:
+        case Kind::ID_IN:
+            return false;
+        }
+        return false;
+    }
+
+    std::optional<std::vector<SearchServer::PostingKey>> SearchServer::GetFilterCandidates(
+            const DocumentFilter::Node& node) const {
+        using Kind = DocumentFilter::Kind;
+        switch (node.kind) {
+        case Kind::ID_IN: {
+            std::vector<PostingKey> keys;
+            for (const int document_id : node.document_ids) {
+                const auto document_pos = documents_.find(document_id);
+                if (document_pos != documents_.end()) {
+                    keys.push_back({document_pos->second.status, document_id});
+                }
+            }
+            std::sort(keys.begin(), keys.end());
+            return keys;
+        }
+        case Kind::RATING_BETWEEN: {
+            if (node.min_rating > node.max_rating) {
+                return std::vector<PostingKey>{};
+            }
+            const auto begin = std::lower_bound(rating_index_.begin(), rating_index_.end(),
+                                                std::pair{node.min_rating, GetSegmentBegin(DocumentStatus::ACTUAL)});
+            const auto end = node.max_rating == std::numeric_limits<int>::max()
+                    ? rating_index_.end()
+                    : std::lower_bound(begin, rating_index_.end(),
+                                       std::pair{node.max_rating + 1, GetSegmentBegin(DocumentStatus::ACTUAL)});
+            // широкий диапазон выгоднее проверять при обходе, чем пересекать со списками
+            if (static_cast<size_t>(end - begin) * RATING_CANDIDATE_RATIO > documents_.size()) {
+                return std::nullopt;
+            }
+            std::vector<PostingKey> keys;
+            keys.reserve(end - begin);
+            for (auto it = begin; it != end; ++it) {
+                keys.push_back(it->second);
+            }
+            std::sort(keys.begin(), keys.end());
+            return keys;
+        }
+        case Kind::AND: {
+            // хватает одной ограниченной стороны; вторую проверит DocumentFilter::Evaluate
+            auto lhs = GetFilterCandidates(*node.lhs);
+            auto rhs = GetFilterCandidates(*node.rhs);
+            if (lhs && rhs) {
+                std::vector<PostingKey> keys;
+                std::set_intersection(lhs->begin(), lhs->end(), rhs->begin(), rhs->end(), std::back_inserter(keys));
+                return keys;
+            }
+            return lhs ? std::move(lhs) : std::move(rhs);
+        }
+        case Kind::OR: {
+            const auto lhs = GetFilterCandidates(*node.lhs);
+            if (!lhs) {
+                return std::nullopt;
+            }
+            const auto rhs = GetFilterCandidates(*node.rhs);
+            if (!rhs) {
+                return std::nullopt;
+            }
+            std::vector<PostingKey> keys;
+            std::set_union(lhs->begin(), lhs->end(), rhs->begin(), rhs->end(), std::back_inserter(keys));
+            return keys;
+        }
+        case Kind::STATUS_IN:
+        case Kind::NOT:
+            return std::nullopt;
+        }
+        return std::nullopt;
+    }
+
+    void SearchServer::SetAdaptiveThresholds(const AdaptiveThresholds& thresholds) {
+        adaptive_thresholds_ = thresholds;
+    }
+
+    const AdaptiveThresholds& SearchServer::GetAdaptiveThresholds() const {
+        return adaptive_thresholds_;
+    }
+
+    uint64_t SearchServer::GetExecutionPathCount(ExecutionPath path) const {
+        return execution_paths_.Get(path);
+    }
+
+    void SearchServer::SaveSnapshot(std::string& out) const {
+        WriteBinary(out, static_cast<uint32_t>(stop_words_.size()));
+        for (std::string_view word : stop_words_) {
+            WriteBinary(out, word);
+        }
+        WriteBinary(out, static_cast<uint32_t>(documents_.size()));
+        for (const auto& [document_id, document] : documents_) {
+            WriteBinary(out, static_cast<int32_t>(document_id));
+            WriteBinary(out, static_cast<uint8_t>(document.status));
+            WriteBinary(out, static_cast<int32_t>(document.rating));
+            const TermCounts& document_words = GetWordCounts(document_id);
+            WriteBinary(out, static_cast<uint32_t>(document_words.size()));
+            for (const auto& [word, count] : document_words) {
+                WriteBinary(out, word);
+                WriteBinary(out, static_cast<uint32_t>(count));
+            }
+        }
+    }
+
+    SearchServer SearchServer::LoadSnapshot(std::string_view data, std::pmr::memory_resource* resource) {
+        BinaryReader reader(data);
+        std::vector<std::string_view> stop_words(reader.Read<uint32_t>());
+        for (std::string_view& word : stop_words) {
+            word = reader.ReadString();
+        }
+        SearchServer search_server(stop_words, resource);
+
+        // текст документа собирается из счётчиков: порядок слов на индекс не влияет
+        const uint32_t document_count = reader.Read<uint32_t>();
+        std::vector<std::string> texts(document_count);
+        std::vector<DocumentSource> documents(document_count);
+        for (uint32_t i = 0; i < document_count; ++i) {
+            DocumentSource& document = documents[i];
+            document.id = reader.Read<int32_t>();
+            document.status = static_cast<DocumentStatus>(reader.Read<uint8_t>());
+            document.ratings = {reader.Read<int32_t>()};
+            const uint32_t word_count = reader.Read<uint32_t>();
+            for (uint32_t j = 0; j < word_count; ++j) {
+                const std::string_view word = reader.ReadString();
+                for (uint32_t count = reader.Read<uint32_t>(); count > 0; --count) {
+                    texts[i] += word;
+                    texts[i] += ' ';
+                }
+            }
+            document.text = texts[i];
+        }
+        if (!reader.AtEnd()) {
+            throw std::runtime_error("Лишние данные в конце снимка индекса.");
+        }
+        search_server.AddDocuments(std::execution::par, documents);
+        return search_server;
+    }
+
+    MemoryStats SearchServer::GetMemoryStats() const {
+        MemoryStats stats;
+        stats.terms = memory_->terms.GetBytes();
+        stats.postings = memory_->postings.GetBytes();
+        stats.forward_index = memory_->forward_index.GetBytes();
+        stats.attributes = memory_->attributes.GetBytes();
+        stats.caches = memory_->caches.GetBytes();
+        return stats;
+    }
+
+    std::pmr::memory_resource* SearchServer::GetMemoryResource() const {
+        return memory_->terms.GetUpstream();
+    }
+
+    std::pmr::set<int>::iterator SearchServer::begin() {
         return documents_ids_.begin();
     }
 
-    std::set<int>::const_iterator SearchServer::begin() const {
+    std::pmr::set<int>::const_iterator SearchServer::begin() const {
         return documents_ids_.begin();
     }
 
-    std::set<int>::iterator SearchServer::end() {
+    std::pmr::set<int>::iterator SearchServer::end() {
         return documents_ids_.end();
     }
 
-    std::set<int>::const_iterator SearchServer::end() const {
+    std::pmr::set<int>::const_iterator SearchServer::end() const {
         return documents_ids_.end();
     }
 
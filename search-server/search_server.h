@@ -1,7 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <set>
+#include <span>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -9,11 +17,22 @@
 
 #include <functional>
 #include <execution>
+#include <limits>
+#include <thread>
 
 #include "document.h"
+#include "document_filter.h"
 #include "string_processing.h"
 
 #include "concurrent_map.h"
+#include "execution_mode.h"
+#include "interleaved_task.h"
+#include "intersection.h"
+#include "memory_accounting.h"
+#include "plan_cache.h"
+#include "query_stats.h"
+#include "scratch_arena.h"
+#include "trace.h"
 //using
 
 const size_t MAX_RESULT_DOCUMENT_COUNT {5};
@@ -23,18 +42,67 @@ public:
 
     using DataAfterMatching = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
-    SearchServer() = default; // старые тесты без стоп слов
+    // TF хранится целым числом вхождений слова; TF = count / длина документа (без стоп-слов).
+    // Релевантность считается как (sum count * idf) / длина и совпадает с прежним суммированием
+    // долей 1.0 / длина с точностью до 1e-12 относительной погрешности.
+    using TermCount = uint32_t;
+    using TermCounts = std::pmr::map<std::string_view, TermCount>;
+
+    // Результат поиска со сроком: truncated — срок истёк до конца подсчёта, документы ранжированы
+    // по уже обойдённым словам запроса (лучшее, что успели), минус-слова учтены всегда.
+    struct TimedResult {
+        std::vector<Document> documents;
+        bool truncated {false};
+    };
+
+    class PreparedQuery; // разобранный и проверенный запрос для многократного выполнения, см. Prepare
+
+    // документ для AddDocuments; text должен жить до конца вызова
+    struct DocumentSource {
+        int id {0};
+        std::string_view text;
+        DocumentStatus status {DocumentStatus::ACTUAL};
+        std::vector<int> ratings;
+    };
 
+    SearchServer() // старые тесты без стоп слов
+        : SearchServer(std::string_view{}) {}
+
+    // resource — откуда берётся память словаря, списков id, прямого индекса, атрибутов и кэшей.
+    // Если используются параллельные политики, ресурс должен быть потокобезопасным.
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
+    explicit SearchServer(const StringContainer& stop_words,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    explicit SearchServer(const std::string& stop_words_text,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : SearchServer(SplitIntoWords(stop_words_text), resource) {} // Invoke delegating constructor from string container
 
-    explicit SearchServer(const std::string& stop_words_text)
-        : SearchServer(SplitIntoWords(stop_words_text)) {} // Invoke delegating constructor from string container
+    explicit SearchServer(std::string_view stop_words_text,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : SearchServer(SplitIntoWords(stop_words_text), resource) {}
 
-    explicit SearchServer(std::string_view stop_words_text)
-        : SearchServer(SplitIntoWords(stop_words_text)) {}
+    // копия получает собственные счётчики памяти над тем же ресурсом и пустой кэш планов
+    SearchServer(const SearchServer& other);
+    SearchServer& operator=(const SearchServer& other);
+    SearchServer(SearchServer&&) = default;
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Добавление пачкой: тексты разбираются независимо (в par — параллельно), затем слова группируются
+    // и каждый список id пополняется за один проход. Пачка проверяется целиком до изменений индекса.
+    void AddDocuments(const std::vector<DocumentSource>& documents);
+    void AddDocuments(std::execution::sequenced_policy, const std::vector<DocumentSource>& documents);
+    void AddDocuments(std::execution::parallel_policy, const std::vector<DocumentSource>& documents);
+
+    // Переиндексация существующего документа: новый набор слов сравнивается с прямым индексом,
+    // и меняются только списки id слов, которые появились, исчезли или изменили число вхождений
+    // (при смене статуса — все слова документа: ключ списка содержит статус).
+    void UpdateDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Только статус и рейтинг, без разбора текста. Смена рейтинга — O(log N);
+    // смена статуса переносит узлы списков id документа в другой сегмент без перевыделения памяти.
+    void UpdateDocumentAttributes(int document_id, DocumentStatus status, const std::vector<int>& ratings);
 //new
     template <typename ExecutionPolicy, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
@@ -49,35 +117,296 @@ public:
 
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
 
+    // Последовательный поиск без выделения памяти под результат: лучшие документы пишутся в out по порядку,
+    // возвращается их число — не больше out.size() и MAX_RESULT_DOCUMENT_COUNT.
+    // Кандидаты живут в ScratchArena потока, так что в установившемся режиме запрос не обращается к куче
+    template <typename DocumentPredicate>
+    size_t FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, std::span<Document> out) const;
+
+    size_t FindTopDocuments(std::string_view raw_query, DocumentStatus status, std::span<Document> out) const;
+
+    // Постраничный обход выдачи: count документов строго после курсора, в порядке IsRankedBefore.
+    // Курсор работает как порог-фильтр, лучшие count выбираются частичной сортировкой,
+    // поэтому глубокая страница стоит столько же, сколько первая. Курсор следующей страницы — SearchCursor(result.back()).
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           const SearchCursor& after, size_t count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           const SearchCursor& after, size_t count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const SearchCursor& after,
+                                           size_t count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Последовательный поиск со сроком: срок проверяется между списками id слов запроса,
+    // после его истечения оставшиеся плюс-слова не обходятся.
+    template <typename DocumentPredicate>
+    TimedResult FindTopDocumentsWithDeadline(std::string_view raw_query, DocumentPredicate document_predicate,
+                                             std::chrono::steady_clock::time_point deadline) const;
+
+    TimedResult FindTopDocumentsWithDeadline(std::string_view raw_query, DocumentStatus status,
+                                             std::chrono::steady_clock::time_point deadline) const;
+
+    // Последовательный поиск, как FindTopDocuments(raw_query, ...), с заполнением stats.
+    // Остальные перегрузки инстанцируют поиск без счётчиков и статистикой не платят.
+    // Без measure_phases счётчики собираются, а время по фазам — нет: не нужны четыре чтения часов на запрос.
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           QueryStats& stats, bool measure_phases = true) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, QueryStats& stats,
+                                           bool measure_phases = true) const;
+
+    // Запросы (по статусу ACTUAL) выполняются на текущем потоке группами по group_size корутин:
+    // перед чтением куска списка id или строк его документов запрос делает prefetch и уступает поток,
+    // так что промахи кэша разных запросов перекрываются. Результаты совпадают с FindTopDocuments(query).
+    std::vector<std::vector<Document>> FindTopDocumentsInterleaved(std::span<const std::string> raw_queries,
+                                                                   size_t group_size = 16) const;
+
+    // Разбирает и проверяет запрос один раз; слова сразу сопоставляются спискам индекса вместе с IDF.
+    // После AddDocument/RemoveDocument сопоставление обновляется при следующем выполнении.
+    PreparedQuery Prepare(std::string_view raw_query) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                           const PreparedQuery& query, DocumentPredicate document_predicate) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                           const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
     int GetDocumentCount() const;
 
     DataAfterMatching MatchDocument(std::string_view raw_query, int document_id) const;
     DataAfterMatching MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const;
     DataAfterMatching MatchDocument(std::execution::parallel_policy, std::string_view raw_query, int document_id) const;
+    DataAfterMatching MatchDocument(const AdaptivePolicy&, std::string_view raw_query, int document_id) const;
+    DataAfterMatching MatchDocument(const PreparedQuery& query, int document_id) const;
+    DataAfterMatching MatchDocument(std::string_view raw_query, int document_id, QueryStats& stats) const;
 
     //int GetDocumentId(int index) const; //- отказ 5 спринт
-    const std::map<std::string_view, double> &GetWordFrequencies(int index) const;
+    std::map<std::string_view, double> GetWordFrequencies(int index) const; // слово -> TF, считается по TermCounts
+    const TermCounts& GetWordCounts(int index) const;
 
+    // Удаление и UpdateDocument не убирают слова из словаря: у слова без документов остаётся пустой список id.
+    // string_view из MatchDocument и GetWordFrequencies ссылаются на строки словаря и остаются действительными
+    // после изменения индекса, пока жив сервер.
     void RemoveDocument(int index);
     void RemoveDocument(std::execution::sequenced_policy, int index);
     void RemoveDocument(std::execution::parallel_policy, int index);
+    void RemoveDocument(const AdaptivePolicy&, int index);
+
+    // Удаление пачкой: слова всех документов группируются, и каждый затронутый список id чистится
+    // за один проход (в par — параллельно по словам). Несуществующие и повторные id пропускаются.
+    void RemoveDocuments(const std::vector<int>& document_ids);
+    void RemoveDocuments(std::execution::sequenced_policy, const std::vector<int>& document_ids);
+    void RemoveDocuments(std::execution::parallel_policy, const std::vector<int>& document_ids);
+    void RemoveDocuments(const AdaptivePolicy&, const std::vector<int>& document_ids);
+
+    void SetAdaptiveThresholds(const AdaptiveThresholds& thresholds);
+    const AdaptiveThresholds& GetAdaptiveThresholds() const;
+    uint64_t GetExecutionPathCount(ExecutionPath path) const; // сколько вызовов в adaptive_policy выбрали path
+
+    // план, по которому будет выполнен запрос: стратегия, порядок слов, отброшенные слова
+    std::string Explain(std::string_view raw_query) const;
+
+    // слово разобранного запроса и длина его списка id по всем статусам (0 — слова нет в индексе)
+    struct QueryTerm {
+        std::string_view word; // ссылается на raw_query
+        bool is_minus {false};
+        bool is_required {false};
+        size_t posting_size {0};
+    };
+
+    // сначала плюс-слова, затем минус-слова, каждые по алфавиту; стоп-слова и повторы отброшены
+    std::vector<QueryTerm> DescribeQuery(std::string_view raw_query) const;
+
+    // Снимок индекса: стоп-слова и для каждого документа id, статус, рейтинг и число вхождений слов.
+    // Загрузка идёт через AddDocuments(par) по восстановленным из счётчиков текстам.
+    void SaveSnapshot(std::string& out) const;
+    static SearchServer LoadSnapshot(std::string_view data,
+                                     std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    MemoryStats GetMemoryStats() const;
+    std::pmr::memory_resource* GetMemoryResource() const;
 
-    std::set<int>::iterator begin();
-    std::set<int>::const_iterator begin() const;
-    std::set<int>::iterator end();
-    std::set<int>::const_iterator end() const;
+    std::pmr::set<int>::iterator begin();
+    std::pmr::set<int>::const_iterator begin() const;
+    std::pmr::set<int>::iterator end();
+    std::pmr::set<int>::const_iterator end() const;
 
 private:
     struct DocumentData {
         int rating {0};
         DocumentStatus status {DocumentStatus::ACTUAL};
+        TermCount length {0}; // слов без стоп-слов: знаменатель TF
+    };
+
+    // Ключ списка id: сначала статус, потом id. Документы одного статуса лежат в списке подряд,
+    // поэтому запрос с фильтром по статусу проходит только свой сегмент.
+    struct PostingKey {
+        DocumentStatus status {DocumentStatus::ACTUAL};
+        int document_id {0};
+
+        auto operator<=>(const PostingKey&) const = default;
     };
 
-    std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string, std::map<int, double>, std::less<>> word_to_document_freqs_; // word -> id документов с word и их idf*tf
-    std::map<int, std::map<std::string_view, double>> words_freqs_by_documents_;
-    std::map<int, DocumentData> documents_;  // id + средний рейтинг + статус
-    std::set<int> documents_ids_;
+    // (статус, id) -> число вхождений слова. Память списков берётся из своего ресурса, заданного при создании:
+    // allocator_type закрыт наследованием, поэтому словарь не подменяет его своим при вставке.
+    class Posting : private std::pmr::map<PostingKey, TermCount> {
+        using Base = std::pmr::map<PostingKey, TermCount>;
+
+    public:
+        explicit Posting(std::pmr::memory_resource* resource)
+            : Base(resource) {}
+
+        using Base::key_type;
+        using Base::mapped_type;
+        using Base::value_type;
+        using Base::key_compare;
+        using Base::iterator;
+        using Base::const_iterator;
+
+        using Base::begin;
+        using Base::end;
+        using Base::size;
+        using Base::empty;
+        using Base::find;
+        using Base::count;
+        using Base::lower_bound;
+        using Base::upper_bound;
+        using Base::key_comp;
+        using Base::erase;
+        using Base::insert;
+        using Base::extract;
+        using Base::emplace;
+        using Base::emplace_hint;
+        using Base::operator[];
+    };
+
+    // Срок запроса для FindTopDocumentsWithDeadline; Expired запоминает истечение, чтобы дальше не читать часы
+    struct QueryDeadline {
+        std::chrono::steady_clock::time_point at;
+        bool expired {false};
+
+        bool Expired() {
+            if (!expired && std::chrono::steady_clock::now() >= at) {
+                expired = true;
+            }
+            return expired;
+        }
+    };
+
+    // Фильтр только по статусу; перегрузки FindTopDocuments(..., DocumentStatus) разрешаются в него
+    // на этапе компиляции и идут по сегменту списка вместо вызова предиката для каждого id.
+    struct StatusPredicate {
+        DocumentStatus status {DocumentStatus::ACTUAL};
+
+        bool operator()([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) const {
+            return document_status == status;
+        }
+    };
+
+    // DocumentFilter, подготовленный к обходу списков id. Статусы сужают обход до своих сегментов;
+    // явные id (IdIn) и узкий диапазон рейтингов (отрезок rating_index_) дают короткий список кандидатов
+    // для пересечения со списками. Остальное — широкий рейтинг, отрицание — проверяется по документу при обходе.
+    struct CompiledFilter {
+        std::shared_ptr<const DocumentFilter::Node> root;
+        uint8_t status_mask {0};            // бит статуса: документы этого статуса могут пройти фильтр
+        bool probes_rating {false};         // в фильтре есть RatingBetween: для проверки нужен рейтинг документа
+        bool has_candidates {false};        // фильтр ограничен явными id или узким диапазоном рейтингов
+        std::vector<PostingKey> candidates; // при has_candidates — все документы, прошедшие фильтр, отсортированы
+
+        bool AcceptsStatus(DocumentStatus status) const {
+            return (status_mask >> static_cast<int>(status)) & 1u;
+        }
+    };
+
+    enum class QueryStrategy {
+        EXHAUSTIVE,   // обход всех списков плюс-слов
+        PRUNED,       // слова с idf = 0 не обходятся, документы с нулевой релевантностью добираются только при нехватке
+        INTERSECTION, // есть обязательные слова: пересечение списков от редкого к частому
+    };
+
+    struct PlannedTerm {
+        std::string_view word;            // ключ word_to_document_freqs_
+        const Posting* posting {nullptr};
+        double inverse_document_freq {0.0};
+    };
+
+    // Результат планирования: слова запроса, сопоставленные спискам индекса.
+    // Действителен, пока индекс не менялся (index_version_).
+    struct QueryPlan {
+        explicit QueryPlan(std::pmr::memory_resource* resource)
+            : scoring_terms(resource)
+            , required_terms(resource)
+            , minus_terms(resource)
+            , pruned_words(resource) {
+        }
+
+        QueryStrategy strategy {QueryStrategy::EXHAUSTIVE};
+        std::pmr::vector<PlannedTerm> scoring_terms;     // плюс-слова с idf > 0, от редких к частым
+        std::pmr::vector<PlannedTerm> required_terms;    // обязательные слова с idf > 0, от редких к частым
+        std::pmr::vector<PlannedTerm> minus_terms;
+        std::pmr::vector<std::string_view> pruned_words; // встречаются во всех документах
+        bool matches_all {false}; // отброшенное плюс-слово есть в каждом документе: все документы релевантны (с нулём)
+        bool is_empty {false};    // обязательного слова нет в индексе
+        uint64_t index_version {0}; // версия индекса, по которой построен план
+    };
+
+    // по счётчику на структуру; в unique_ptr, чтобы адреса ресурсов не менялись при перемещении сервера
+    struct MemoryResources {
+        explicit MemoryResources(std::pmr::memory_resource* upstream)
+            : terms(upstream)
+            , postings(upstream)
+            , forward_index(upstream)
+            , attributes(upstream)
+            , caches(upstream) {
+        }
+
+        CountingResource terms;
+        CountingResource postings;
+        CountingResource forward_index;
+        CountingResource attributes;
+        CountingResource caches;
+    };
+
+    std::unique_ptr<MemoryResources> memory_; // объявлен первым: контейнеры ниже живут в его ресурсах
+
+    std::pmr::set<std::pmr::string, std::less<>> stop_words_;
+    using Dictionary = std::pmr::map<std::pmr::string, Posting, std::less<>>;
+
+    Dictionary word_to_document_freqs_; // word -> (статус, id) документов с word и их tf
+    std::pmr::map<int, TermCounts> words_freqs_by_documents_;
+    std::pmr::map<int, DocumentData> documents_;  // id + средний рейтинг + статус
+    std::pmr::set<int> documents_ids_;
+
+    // индексы атрибутов для DocumentFilter и добора документов с нулевой релевантностью
+    std::pmr::set<PostingKey> status_index_; // все документы по (статус, id); статус — непрерывный отрезок
+    // (рейтинг, документ) по возрастанию: диапазон рейтингов — отрезок, его длина известна за два поиска.
+    // Вектор, а не дерево: одиночная вставка сдвигает хвост, пакетные добавление и удаление проходят его один раз
+    std::pmr::vector<std::pair<int, PostingKey>> rating_index_;
+    // копия documents_ по id: рейтинг для проверки фильтра при обходе списков, длина для MakeDocument.
+    // Адрес строки известен без обхода дерева, поэтому её можно запросить prefetch заранее.
+    // Растёт, только пока id не намного реже документов; документы с id за его концом читаются из documents_
+    std::pmr::vector<DocumentData> document_rows_;
+
+    AdaptiveThresholds adaptive_thresholds_;
+    mutable ExecutionPathCounter execution_paths_;
+
+    uint64_t index_version_ {0}; // меняется при каждом изменении индекса, сбрасывает кэш планов
+    mutable PlanCache<QueryPlan> plan_cache_;
+
+    // Плоские копии списков id по словам для FindTopDocumentsInterleaved: в векторе адрес следующего куска
+    // известен заранее и запрашивается prefetch, не дожидаясь чтения текущего узла дерева.
+    // Строятся при первом чередующемся запросе со словом и, как планы, действительны до изменения индекса
+    using PostingEntries = std::pmr::vector<std::pair<PostingKey, TermCount>>;
+    mutable PlanCache<PostingEntries> posting_snapshots_;
 
     //=======================
 
@@ -89,40 +418,209 @@ private:
 
     static int ComputeAverageRating(const std::vector<int>& ratings); // считаем средний рейтинг
 
+    explicit SearchServer(std::unique_ptr<MemoryResources> memory);
+
+    Dictionary::iterator GetOrCreatePosting(std::string_view word); // новое слово попадает в словарь с пустым списком
+
+    void CopyIndexFrom(const SearchServer& other); // в пустой сервер; прямой индекс ссылается на свой словарь
+
     struct QueryWord {
         std::string_view data;
         bool is_minus{false};
+        bool is_required{false};
         bool is_stop{false};
     };
 
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        explicit Query(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : plus_words(resource)
+            , minus_words(resource)
+            , required_words(resource) {
+        }
+
+        std::pmr::vector<std::string_view> plus_words;     // все слова, дающие релевантность (включая обязательные)
+        std::pmr::vector<std::string_view> minus_words;
+        std::pmr::vector<std::string_view> required_words; // +word: документ должен содержать их все
     };
 
-    Query ParseQuery(std::string_view text) const ; //разбиваем на +- слова
+    // resource — ScratchArena для разового запроса, по умолчанию — для хранимого (PreparedQuery)
+    Query ParseQuery(std::string_view text,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const ; //разбиваем на +- слова
 
     QueryWord ParseQueryWord(std::string_view text) const; // mb bool
 
     double ComputeWordInverseDocumentFreq(std::string_view word) const;
 
+    static std::pmr::string MakePlanKey(const Query& query, std::pmr::memory_resource* resource); // каноническая форма запроса: "+обязательные плюс -минус"
+
+    QueryPlan BuildQueryPlan(const Query& query,
+                             std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+    // план из кэша или построенный заново; исключения разбора запроса бросаются отсюда
+    std::shared_ptr<const QueryPlan> GetQueryPlan(std::string_view raw_query, bool* from_cache = nullptr) const;
+
+    // план подготовленного запроса; устаревший после изменения индекса строится заново
+    std::shared_ptr<const QueryPlan> GetPreparedPlan(const PreparedQuery& query) const;
+
+    ExecutionPath ChooseExecutionPath(const QueryPlan& plan) const;
+
+    template <typename Stats = NoQueryStats>
+    DataAfterMatching MatchQuery(const Query& query, int document_id, Stats* stats = nullptr) const;
+
+    // найденные документы запроса; память из ScratchArena, наружу отдаются только копии лучших
+    using DocumentCandidates = std::pmr::vector<Document>;
+
+    // выполнение готового плана: отбор, добор нулевых, сортировка и усечение до MAX_RESULT_DOCUMENT_COUNT
     template <typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const ExecutionPolicy& policy,
-                                           const Query& query, DocumentPredicate document_predicate) const;
+    DocumentCandidates ExecuteQueryPlan(const ExecutionPolicy& policy, const QueryPlan& plan,
+                                        DocumentPredicate document_predicate) const;
+
+    static PostingKey GetSegmentBegin(DocumentStatus status); // первый возможный ключ сегмента статуса
+    static PostingKey GetSegmentEnd(DocumentStatus status);   // первый ключ за сегментом статуса
+
+    // Диапазон рейтингов становится списком кандидатов, если в нём не больше 1/RATING_CANDIDATE_RATIO документов:
+    // пересечение с таким списком дешевле проверки каждого элемента списков id
+    static constexpr size_t RATING_CANDIDATE_RATIO = 16;
+
+    // документ key, уже записанный в documents_, — в таблицы атрибутов
+    void InsertDocumentAttributes(const PostingKey& key, const DocumentData& document);
+
+    void EraseDocumentAttributes(const PostingKey& key);
 
+    // keys отсортированы; rating_index_ проходится один раз на весь пакет
+    void EraseDocumentsAttributes(const std::pmr::vector<PostingKey>& keys);
+
+    void ReleaseEmptyRatingIndexes();
+
+    void StoreDocumentRow(int document_id, const DocumentData& document);
+
+    // строка document_rows_ или nullptr, если id за его концом
+    const DocumentData* FindDocumentRow(int document_id) const {
+        return static_cast<size_t>(document_id) < document_rows_.size() ? &document_rows_[document_id] : nullptr;
+    }
+
+    const DocumentData& GetDocumentData(int document_id) const {
+        const DocumentData* row = FindDocumentRow(document_id);
+        return row != nullptr ? *row : documents_.at(document_id);
+    }
+
+    int GetDocumentRating(int document_id) const {
+        return GetDocumentData(document_id).rating;
+    }
+
+    // статус и рейтинг документа old_key во всех таблицах атрибутов; списки id не трогает
+    void ReplaceDocumentAttributes(const PostingKey& old_key, DocumentStatus status, int rating);
+
+    static void MovePosting(Posting& posting, const PostingKey& old_key, const PostingKey& new_key, TermCount count);
+
+    void EraseDocuments(const std::vector<int>& document_ids, bool in_parallel);
+
+    void InsertDocuments(const std::vector<DocumentSource>& documents, bool in_parallel);
+
+    static void ErasePostings(Posting& posting, const std::pmr::vector<PostingKey>& keys); // keys отсортированы
+
+    CompiledFilter CompileFilter(std::shared_ptr<const DocumentFilter::Node> root) const;
+
+    static uint8_t GetFilterStatusMask(const DocumentFilter::Node& node); // статусы, которые узел может пропустить
+    static bool FilterProbesRating(const DocumentFilter::Node& node);
+
+    // отсортированные документы, вне которых узел ничего не пропускает (внутри могут быть и не проходящие);
+    // nullopt — узел не ограничен ни явными id, ни узким диапазоном рейтингов
+    std::optional<std::vector<PostingKey>> GetFilterCandidates(const DocumentFilter::Node& node) const;
+
+    // DocumentFilter разворачивается в CompiledFilter, остальные предикаты передаются как есть
+    template <typename DocumentPredicate>
+    auto CompilePredicate(const DocumentPredicate& document_predicate) const;
+
+    // часть списка id, которую нужно пройти для данного предиката
+    template <typename DocumentPredicate>
+    static std::pair<Posting::const_iterator, Posting::const_iterator> GetPostingRange(const Posting& posting,
+                                                                                      const DocumentPredicate& document_predicate);
+
+    template <typename DocumentPredicate>
+    bool IsAcceptedDocument(const PostingKey& key, const DocumentPredicate& document_predicate) const;
+
+    // callback(key, term_count) для каждого документа списка, прошедшего предикат
+    template <typename DocumentPredicate, typename Callback, typename Stats = NoQueryStats>
+    void ForEachPosting(const Posting& posting, const DocumentPredicate& document_predicate, Callback callback,
+                        Stats* stats = nullptr) const;
+
+    // sum count * idf -> релевантность: делим на длину документа один раз, а не для каждого слова
+    Document MakeDocument(int document_id, double weighted_count) const;
+
+    template <typename ExecutionPolicy>
+    static void SortAndTruncate(const ExecutionPolicy& policy, DocumentCandidates& documents);
+
+    // оставляет count лучших документов после курсора, отсортированными
+    static void SelectPageAfter(const SearchCursor& after, size_t count, DocumentCandidates& documents);
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    DocumentCandidates FindAllDocuments(const ExecutionPolicy& policy,
+                                        const QueryPlan& plan, DocumentPredicate document_predicate) const;
+
+    template <typename DocumentPredicate, typename Stats = NoQueryStats>
+    DocumentCandidates FindAllDocuments(const QueryPlan& plan, DocumentPredicate document_predicate,
+                                        QueryDeadline* deadline = nullptr, Stats* stats = nullptr) const;
+
+    // режим AND: кандидаты — пересечение списков обязательных слов, от самого короткого к длинному
+    template <typename DocumentPredicate, typename Stats = NoQueryStats>
+    DocumentCandidates FindAllDocumentsConjunctive(const QueryPlan& plan, DocumentPredicate document_predicate,
+                                                   QueryDeadline* deadline = nullptr, Stats* stats = nullptr) const;
+
+    // списки id плюс-слов режутся на диапазоны id примерно по range_size элементов, куски обрабатываются параллельно
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    DocumentCandidates FindAllDocumentsParallel(const QueryPlan& plan, DocumentPredicate document_predicate,
+                                                size_t range_size) const;
+
+    // корутина одного запроса для FindTopDocumentsInterleaved; вклады слов копятся в плоском векторе, а не в дереве
+    InterleavedTask FindTopDocumentsCoroutine(std::string_view raw_query, std::vector<Document>& result) const;
+
+    // плоская копия списка id слова из posting_snapshots_; отсутствующая или устаревшая строится заново
+    std::shared_ptr<const PostingEntries> GetPostingSnapshot(const PlannedTerm& term) const;
+
+    // элементы копии списка с данным статусом
+    static std::span<const PostingEntries::value_type> GetSegment(const PostingEntries& entries, DocumentStatus status);
+
+    // стратегия PRUNED: если положительных результатов меньше limit, добирает документы с нулевой релевантностью
+    template <typename DocumentPredicate>
+    void AddZeroRelevanceDocuments(const QueryPlan& plan, const DocumentPredicate& document_predicate,
+                                   DocumentCandidates& documents, size_t limit = MAX_RESULT_DOCUMENT_COUNT) const;
+
+};
+
+class SearchServer::PreparedQuery {
+public:
+    std::string_view GetText() const {
+        return state_->text;
+    }
 
+private:
+    friend class SearchServer;
+
+    struct State {
+        std::string text;   // слова запроса ссылаются на эту строку
+        Query query;
+        const SearchServer* server {nullptr};
+        std::atomic<std::shared_ptr<const QueryPlan>> plan; // обновляется из любого потока при устаревании
+    };
+
+    explicit PreparedQuery(std::shared_ptr<State> state)
+        : state_(std::move(state)) {}
+
+    std::shared_ptr<State> state_; // копии разделяют состояние и обновлённый план
 };
 
 // ======================================== реализации шаблонов ===========================================
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+SearchServer::SearchServer(const StringContainer& stop_words, std::pmr::memory_resource* resource)
+    : SearchServer(std::make_unique<MemoryResources>(resource))
 {
+    for (const std::string& word : MakeUniqueNonEmptyStrings(stop_words)) {
+        stop_words_.emplace(word);
+    }
     if (std::any_of(stop_words_.cbegin(), stop_words_.cend(),
-                [](const std::string& word){ return !IsValidWord(word); } )) { // при применении none_of - не проходит проверку в тренажере, возможно изза IsValidWord(string_view)
+                [](std::string_view word){ return !IsValidWord(word); } )) { // при применении none_of - не проходит проверку в тренажере, возможно изза IsValidWord(string_view)
         throw std::invalid_argument("Стоп-слово содержит недопустимые символы!");
     } // https://en.cppreference.com/w/cpp/algorithm/all_any_none_of
 }
@@ -130,30 +628,176 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 template <typename ExecutionPolicy,typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy,
                                                      std::string_view raw_query, DocumentPredicate document_predicate) const {
+    TRACE_SCOPE("FindTopDocuments");
+    const ScratchArena::Scope scratch;
+    std::shared_ptr<const QueryPlan> plan;
+    {
+        TRACE_SCOPE("GetQueryPlan");
+        plan = GetQueryPlan(raw_query);// исключения бросаются в ParseQueryWord
+    }
+    const DocumentCandidates result = ExecuteQueryPlan(policy, *plan, document_predicate);
+    return {result.begin(), result.end()};
+}
 
-    const Query query = ParseQuery(raw_query);// исключения бросаются в ParseQueryWord
-    std::vector<Document> result = FindAllDocuments(policy, query, document_predicate);
+template <typename DocumentPredicate>
+size_t SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                      std::span<Document> out) const {
+    TRACE_SCOPE("FindTopDocuments");
+    const ScratchArena::Scope scratch;
+    const auto plan = GetQueryPlan(raw_query);
+    const auto predicate = CompilePredicate(document_predicate);
+    DocumentCandidates result = FindAllDocuments(*plan, predicate);
+    AddZeroRelevanceDocuments(*plan, predicate, result);
+    // сортируются только попадающие в out, и каждый из них пишется в out один раз
+    const size_t count = std::min({result.size(), out.size(), MAX_RESULT_DOCUMENT_COUNT});
+    std::partial_sort(result.begin(), result.begin() + count, result.end(), IsRankedBefore);
+    std::copy_n(result.begin(), count, out.begin());
+    return count;
+}
 
-    const double EPSILON = 1e-6;
-    std::sort(
-            policy,
-            result.begin(), result.end(),
-            [EPSILON](const Document& lhs, const Document& rhs) {
-                if(std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                    return lhs.rating > rhs.rating;
-                }
-                else {
-                    return lhs.relevance > rhs.relevance;
-                }
-         }
-    );
-    if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        result.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy,
+                                                     const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    const ScratchArena::Scope scratch;
+    const auto plan = GetPreparedPlan(query);
+    const DocumentCandidates result = ExecuteQueryPlan(policy, *plan, document_predicate);
+    return {result.begin(), result.end()};
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments(std::execution::seq, query, document_predicate);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy,
+                                                     const PreparedQuery& query, DocumentStatus status) const {
+    return FindTopDocuments(policy, query, StatusPredicate{status});
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchServer::DocumentCandidates SearchServer::ExecuteQueryPlan(const ExecutionPolicy& policy, const QueryPlan& plan,
+                                                                DocumentPredicate document_predicate) const {
+    const auto predicate = CompilePredicate(document_predicate);
+    DocumentCandidates result(ScratchArena::GetResource());
+
+    if constexpr (std::is_same_v<ExecutionPolicy, AdaptivePolicy>) {
+        // сам выбирает последовательный, пословный или по-диапазонный параллельный путь
+        const ExecutionPath path = ChooseExecutionPath(plan);
+        execution_paths_.Add(path);
+        {
+            TRACE_SCOPE("FindAllDocuments");
+            switch (path) {
+            case ExecutionPath::SEQUENTIAL:
+                result = FindAllDocuments(plan, predicate);
+                break;
+            case ExecutionPath::WORD_PARALLEL:
+                result = FindAllDocuments(std::execution::par, plan, predicate);
+                break;
+            case ExecutionPath::RANGE_PARALLEL:
+                result = FindAllDocumentsParallel(plan, predicate, adaptive_thresholds_.range_chunk_size);
+                break;
+            }
+        }
+        {
+            TRACE_SCOPE("AddZeroRelevanceDocuments");
+            AddZeroRelevanceDocuments(plan, predicate, result);
+        }
+        TRACE_SCOPE("SortAndTruncate");
+        if (path == ExecutionPath::SEQUENTIAL) {
+            SortAndTruncate(std::execution::seq, result);
+        } else {
+            SortAndTruncate(std::execution::par, result);
+        }
+    } else {
+        {
+            TRACE_SCOPE("FindAllDocuments");
+            result = FindAllDocuments(policy, plan, predicate);
+        }
+        {
+            TRACE_SCOPE("AddZeroRelevanceDocuments");
+            AddZeroRelevanceDocuments(plan, predicate, result);
+        }
+        TRACE_SCOPE("SortAndTruncate");
+        SortAndTruncate(policy, result);
     }
     return result;
 }
+
+template <typename ExecutionPolicy>
+void SearchServer::SortAndTruncate(const ExecutionPolicy& policy, DocumentCandidates& documents) {
+    std::sort(policy, documents.begin(), documents.end(), IsRankedBefore);
+    if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+}
 // ищем все доки по плюс минус словам запроса, и предикату или DocumentStatus, снизу перегрузки FindTopDocuments.
 
+template <typename DocumentPredicate>
+SearchServer::TimedResult SearchServer::FindTopDocumentsWithDeadline(std::string_view raw_query,
+                                                                     DocumentPredicate document_predicate,
+                                                                     std::chrono::steady_clock::time_point deadline) const {
+    const ScratchArena::Scope scratch;
+    const auto plan = GetQueryPlan(raw_query);
+    const auto predicate = CompilePredicate(document_predicate);
+    QueryDeadline query_deadline {deadline};
+    DocumentCandidates documents = FindAllDocuments(*plan, predicate, &query_deadline);
+    TimedResult result;
+    result.truncated = query_deadline.expired;
+    AddZeroRelevanceDocuments(*plan, predicate, documents);
+    SortAndTruncate(std::execution::seq, documents);
+    result.documents.assign(documents.begin(), documents.end());
+    return result;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     QueryStats& stats, bool measure_phases) const {
+    using Clock = std::chrono::steady_clock;
+    const auto now = [measure_phases] {
+        return measure_phases ? Clock::now() : Clock::time_point{};
+    };
+    stats = QueryStats{};
+    const ScratchArena::Scope scratch;
+
+    const auto parse_start = now();
+    const auto plan = GetQueryPlan(raw_query, &stats.plan_from_cache);
+    const auto predicate = CompilePredicate(document_predicate);
+    // обязательные слова входят и в scoring_terms
+    stats.terms_resolved = plan->scoring_terms.size() + plan->pruned_words.size() + plan->minus_terms.size();
+
+    const auto scoring_start = now();
+    DocumentCandidates result = FindAllDocuments(*plan, predicate, nullptr, &stats);
+
+    const auto ranking_start = now();
+    AddZeroRelevanceDocuments(*plan, predicate, result);
+    stats.candidates_before_top = result.size();
+    SortAndTruncate(std::execution::seq, result);
+
+    const auto finish = now();
+    stats.parse_time = scoring_start - parse_start;
+    stats.scoring_time = ranking_start - scoring_start;
+    stats.ranking_time = finish - ranking_start;
+    return {result.begin(), result.end()};
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     const SearchCursor& after, size_t count) const {
+    const ScratchArena::Scope scratch;
+    const auto plan = GetQueryPlan(raw_query);
+    const auto predicate = CompilePredicate(document_predicate);
+    DocumentCandidates result = FindAllDocuments(*plan, predicate);
+    // нулевые документы стоят в конце выдачи: нужны, только если положительных после курсора не хватает
+    const size_t positive_after = static_cast<size_t>(std::count_if(result.begin(), result.end(),
+        [&after](const Document& document) { return after.Precedes(document); }));
+    if (positive_after < count) {
+        AddZeroRelevanceDocuments(*plan, predicate, result, std::numeric_limits<size_t>::max());
+    }
+    SelectPageAfter(after, count, result);
+    return {result.begin(), result.end()};
+}
+
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
     return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
@@ -162,117 +806,357 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy,
                                        std::string_view raw_query, DocumentStatus status) const {
-        return FindTopDocuments(
-                                policy,
-                                raw_query,
-                                [status]
-                                ([[maybe_unused]]int document_id, DocumentStatus status_predicate, [[maybe_unused]] int rating )
-                                { return status == status_predicate; }
-                               );
+        return FindTopDocuments(policy, raw_query, StatusPredicate{status});
 
 }
 
+template <typename DocumentPredicate>
+auto SearchServer::CompilePredicate(const DocumentPredicate& document_predicate) const {
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+        return CompileFilter(document_predicate.root_);
+    } else {
+        return document_predicate;
+    }
+}
+
+template <typename DocumentPredicate>
+std::pair<SearchServer::Posting::const_iterator, SearchServer::Posting::const_iterator>
+SearchServer::GetPostingRange(const Posting& posting, const DocumentPredicate& document_predicate) {
+    if constexpr (std::is_same_v<DocumentPredicate, StatusPredicate>) {
+        return {posting.lower_bound(GetSegmentBegin(document_predicate.status)),
+                posting.lower_bound(GetSegmentEnd(document_predicate.status))};
+    } else if constexpr (std::is_same_v<DocumentPredicate, CompiledFilter>) {
+        if (document_predicate.has_candidates) {
+            if (document_predicate.candidates.empty()) {
+                return {posting.end(), posting.end()};
+            }
+            return {posting.lower_bound(document_predicate.candidates.front()),
+                    posting.upper_bound(document_predicate.candidates.back())};
+        }
+        if (document_predicate.status_mask == 0) {
+            return {posting.end(), posting.end()};
+        }
+        // от первого допустимого статуса до последнего; статусы между ними отсекает IsAcceptedDocument
+        const int first_status = std::countr_zero(document_predicate.status_mask);
+        const int last_status = std::bit_width(document_predicate.status_mask) - 1;
+        return {posting.lower_bound(GetSegmentBegin(static_cast<DocumentStatus>(first_status))),
+                posting.lower_bound(GetSegmentEnd(static_cast<DocumentStatus>(last_status)))};
+    } else {
+        return {posting.begin(), posting.end()};
+    }
+}
+
+template <typename DocumentPredicate>
+bool SearchServer::IsAcceptedDocument(const PostingKey& key, const DocumentPredicate& document_predicate) const {
+    if constexpr (std::is_same_v<DocumentPredicate, StatusPredicate>) {
+        return key.status == document_predicate.status; // в списках id сегмент выбирается ещё в GetPostingRange
+    } else if constexpr (std::is_same_v<DocumentPredicate, CompiledFilter>) {
+        if (document_predicate.has_candidates) {
+            return std::binary_search(document_predicate.candidates.begin(), document_predicate.candidates.end(), key);
+        }
+        if (!document_predicate.AcceptsStatus(key.status)) {
+            return false;
+        }
+        // рейтинг читается, только если фильтр его проверяет
+        const int rating = document_predicate.probes_rating ? GetDocumentRating(key.document_id) : 0;
+        return DocumentFilter::Evaluate(*document_predicate.root, key.document_id, key.status, rating);
+    } else {
+        return document_predicate(key.document_id, key.status, GetDocumentRating(key.document_id));
+    }
+}
+
+template <typename DocumentPredicate, typename Callback, typename Stats>
+void SearchServer::ForEachPosting(const Posting& posting, const DocumentPredicate& document_predicate, Callback callback,
+                                  [[maybe_unused]] Stats* stats) const {
+    if constexpr (std::is_same_v<DocumentPredicate, CompiledFilter>) {
+        if (document_predicate.has_candidates) {
+            // пересекаем кандидатов со списком: короткий фильтр пропускает почти весь список.
+            // Отвергнутые фильтром элементы пересечение пропускает не глядя, в статистике видны только совпавшие
+            ForEachIntersection(document_predicate.candidates.begin(), document_predicate.candidates.end(), posting,
+                                [&callback, stats](const auto& key_freq) {
+                                    if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+                                        ++stats->postings_scanned;
+                                    }
+                                    callback(key_freq.first, key_freq.second);
+                                });
+            return;
+        }
+    }
+    const auto [posting_begin, posting_end] = GetPostingRange(posting, document_predicate);
+    for (auto it = posting_begin; it != posting_end; ++it) {
+        const bool accepted = IsAcceptedDocument(it->first, document_predicate);
+        if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+            ++stats->postings_scanned;
+            stats->rejected_by_predicate += !accepted;
+        }
+        if (accepted) {
+            callback(it->first, it->second);
+        }
+    }
+}
+
 template <typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy,
-                                       const Query& query, DocumentPredicate document_predicate) const {
+SearchServer::DocumentCandidates SearchServer::FindAllDocuments([[maybe_unused]] const ExecutionPolicy& policy,
+                                                                const QueryPlan& plan,
+                                                                DocumentPredicate document_predicate) const {
     if constexpr
         (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
 
-        return FindAllDocuments(query, document_predicate);
+        return FindAllDocuments(plan, document_predicate);
 
-    } else { // std::execution::parallel_policy
-        size_t available_cores = std::thread::hardware_concurrency() * 10u;
-        ConcurrentMap<int, double> concurent_document_to_relevance(available_cores);
+    } else { // std::execution::parallel_policy: каждое плюс-слово — одна задача
+        return FindAllDocumentsParallel(plan, document_predicate, std::numeric_limits<size_t>::max());
+    }
+}
 
-        auto insert_freq_func = [this, &document_predicate, &concurent_document_to_relevance]
-                                (std::string_view word) {
-            const auto word_pos = word_to_document_freqs_.find(word);
-            if (word_pos != word_to_document_freqs_.end()) {
-                const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+template <typename DocumentPredicate>
+SearchServer::DocumentCandidates SearchServer::FindAllDocumentsParallel(const QueryPlan& plan,
+                                                                        DocumentPredicate document_predicate,
+                                                                        size_t range_size) const {
+    if (plan.strategy == QueryStrategy::INTERSECTION) {
+        return FindAllDocumentsConjunctive(plan, document_predicate);
+    }
 
-                for (const auto [document_id, term_freq] : word_to_document_freqs_.at(std::string(word))) {
-                    const auto& document_data = documents_.at(document_id);
-                    if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                        concurent_document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq; // idf*TF ConcurrentMap
-                    }
-                }
-            }
-        };
+    // Кусок списка задаётся диапазоном id, а не парой итераторов: число кусков считается по хранимому
+    // размеру списка, а границы ищутся lower_bound уже внутри параллельной задачи, без обхода списка заранее
+    struct PostingRange {
+        const Posting* posting {nullptr};
+        int64_t id_begin {0};
+        int64_t id_end {0}; // не включая
+        double inverse_document_freq {0.0};
+    };
 
-        std::for_each(
-                    policy,
-                    query.plus_words.begin(), query.plus_words.end(),
-                    insert_freq_func
-                    );
+    std::pmr::memory_resource* scratch = ScratchArena::GetResource();
+    if (documents_ids_.empty()) {
+        return DocumentCandidates(scratch);
+    }
+    const int64_t min_id = *documents_ids_.begin();
+    const int64_t max_id = *documents_ids_.rbegin();
+    const int64_t id_span = max_id - min_id + 1;
+
+    std::pmr::vector<PostingRange> ranges(scratch);
+    ranges.reserve(plan.scoring_terms.size());
+    // CompiledFilter с кандидатами сам пропускает лишнее пересечением, его список не режем
+    bool intersects_candidates = false;
+    if constexpr (std::is_same_v<DocumentPredicate, CompiledFilter>) {
+        intersects_candidates = document_predicate.has_candidates;
+    }
+    for (const PlannedTerm& term : plan.scoring_terms) {
+        int64_t range_count = 1;
+        if (range_size != std::numeric_limits<size_t>::max() && !intersects_candidates) {
+            const size_t posting_ranges = (term.posting->size() + range_size - 1) / range_size;
+            range_count = std::clamp<int64_t>(static_cast<int64_t>(posting_ranges), 1, id_span);
+        }
+        const int64_t range_width = (id_span + range_count - 1) / range_count;
+        for (int64_t id_begin = min_id; id_begin <= max_id; id_begin += range_width) {
+            ranges.push_back({term.posting, id_begin, std::min(id_begin + range_width, max_id + 1),
+                              term.inverse_document_freq});
+        }
+    }
 
+    size_t available_cores = std::thread::hardware_concurrency() * 10u;
+    ConcurrentMap<int, double> concurent_document_to_relevance(available_cores, scratch);
 
-        auto erase_minus_func = [this, &concurent_document_to_relevance]
-                                (std::string_view word) {
-            const auto word_pos = word_to_document_freqs_.find(word);
-            if (word_pos != word_to_document_freqs_.end()) {
-                for (const auto [document_id, _] : word_pos->second) {
-                    concurent_document_to_relevance.erase(static_cast<size_t>(document_id));
+    auto insert_freq_func = [this, &document_predicate, &concurent_document_to_relevance, max_id]
+                            (const PostingRange& range) {
+        const auto add_relevance = [&concurent_document_to_relevance, &range](const PostingKey& key, TermCount term_count) {
+            concurent_document_to_relevance[key.document_id].ref_to_value += term_count * range.inverse_document_freq; // idf*count ConcurrentMap
+        };
+        if constexpr (std::is_same_v<DocumentPredicate, CompiledFilter>) {
+            if (document_predicate.has_candidates) {
+                ForEachPosting(*range.posting, document_predicate, add_relevance);
+                return;
+            }
+        }
+        // кусок id берётся из каждого сегмента статуса, попавшего в диапазон предиката
+        const Posting& posting = *range.posting;
+        const auto [posting_begin, posting_end] = GetPostingRange(posting, document_predicate);
+        for (auto segment = posting_begin; segment != posting_end; ) {
+            const DocumentStatus status = segment->first.status;
+            const PostingKey segment_end = GetSegmentEnd(status);
+            const auto range_end = range.id_end > max_id
+                    ? posting.lower_bound(segment_end)
+                    : posting.lower_bound({status, static_cast<int>(range.id_end)});
+            for (auto it = posting.lower_bound({status, static_cast<int>(range.id_begin)}); it != range_end; ++it) {
+                if (IsAcceptedDocument(it->first, document_predicate)) {
+                    add_relevance(it->first, it->second);
                 }
             }
-        };
+            segment = posting.lower_bound(segment_end);
+        }
+    };
 
-        std::for_each(
-                    policy,
-                    query.minus_words.begin(), query.minus_words.end(),
-                    erase_minus_func
-                    );
+    std::for_each(
+                std::execution::par,
+                ranges.begin(), ranges.end(),
+                insert_freq_func
+                );
 
 
-        std::map<int, double> document_to_relevance =
-                concurent_document_to_relevance.BuildOrdinaryMap();
+    auto erase_minus_func = [&document_predicate, &concurent_document_to_relevance]
+                            (const PlannedTerm& term) {
+        const auto [posting_begin, posting_end] = GetPostingRange(*term.posting, document_predicate);
+        for (auto it = posting_begin; it != posting_end; ++it) {
+            concurent_document_to_relevance.erase(it->first.document_id);
+        }
+    };
 
-        std::vector<Document> matched_documents;
-        matched_documents.reserve(document_to_relevance.size());
+    std::for_each(
+                std::execution::par,
+                plan.minus_terms.begin(), plan.minus_terms.end(),
+                erase_minus_func
+                );
 
-        for (const auto [document_id, relevance] : document_to_relevance) {
-            matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating}); //пушим id, relevance, rating найденных
-        }
-        return matched_documents;
+
+    const std::pmr::map<int, double> document_to_relevance =
+            concurent_document_to_relevance.BuildOrdinaryMap(scratch);
+
+    DocumentCandidates matched_documents(document_to_relevance.get_allocator());
+    matched_documents.reserve(document_to_relevance.size());
+
+    for (const auto [document_id, weighted_count] : document_to_relevance) {
+        matched_documents.push_back(MakeDocument(document_id, weighted_count)); //пушим id, relevance, rating найденных
     }
+    return matched_documents;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance; // key: id, value: relevance
+template <typename DocumentPredicate, typename Stats>
+SearchServer::DocumentCandidates SearchServer::FindAllDocuments(const QueryPlan& plan,
+                                                                DocumentPredicate document_predicate,
+                                                                QueryDeadline* deadline,
+                                                                [[maybe_unused]] Stats* stats) const {
+    if (plan.strategy == QueryStrategy::INTERSECTION) {
+        return FindAllDocumentsConjunctive(plan, document_predicate, deadline, stats);
+    }
 
-    for (std::string_view word : query.plus_words) {
-        //const auto word_pos = word_to_document_freqs_.find(word);
-        if (word_to_document_freqs_.count(word) == 0) {
-        //if (word_pos == word_to_document_freqs_.end())
-            continue;
-        }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);// compute IDF
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(std::string(word))) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq; // idf*TF
-            }
+    std::pmr::map<int, double> document_to_relevance(ScratchArena::GetResource()); // key: id, value: sum count * idf
+
+    for (const PlannedTerm& term : plan.scoring_terms) {
+        if (deadline && deadline->Expired()) {
+            break;
         }
+        const double inverse_document_freq = term.inverse_document_freq;
+        ForEachPosting(*term.posting, document_predicate,
+                       [&document_to_relevance, inverse_document_freq](const PostingKey& key, TermCount term_count) {
+                           document_to_relevance[key.document_id] += term_count * inverse_document_freq; // idf*count
+                       }, stats);
+    }
+    if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+        stats->documents_scored = document_to_relevance.size();
     }
 
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(std::string(word))) {
-            document_to_relevance.erase(document_id); // delete for minus word
+    for (const PlannedTerm& term : plan.minus_terms) {
+        const auto [posting_begin, posting_end] = GetPostingRange(*term.posting, document_predicate);
+        for (auto it = posting_begin; it != posting_end; ++it) {
+            const size_t erased = document_to_relevance.erase(it->first.document_id); // delete for minus word
+            if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+                ++stats->postings_scanned;
+                stats->excluded_by_minus_words += erased;
+            }
         }
     }
 
-    std::vector<Document> matched_documents;
+    DocumentCandidates matched_documents(document_to_relevance.get_allocator());
     matched_documents.reserve(document_to_relevance.size());
 
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating}); //пушим id, relevance, rating найденных
+    for (const auto [document_id, weighted_count] : document_to_relevance) {
+        matched_documents.push_back(MakeDocument(document_id, weighted_count)); //пушим id, relevance, rating найденных
     }
     return matched_documents;
 }
 
+template <typename DocumentPredicate, typename Stats>
+SearchServer::DocumentCandidates SearchServer::FindAllDocumentsConjunctive(const QueryPlan& plan,
+                                                                           DocumentPredicate document_predicate,
+                                                                           QueryDeadline* deadline,
+                                                                           [[maybe_unused]] Stats* stats) const {
+    std::pmr::memory_resource* scratch = ScratchArena::GetResource();
+    if (plan.is_empty) {
+        return DocumentCandidates(scratch); // обязательного слова нет ни в одном документе
+    }
+
+    // самый редкий список задаёт кандидатов, остальные только сужают их
+    std::pmr::vector<PostingKey> candidates(scratch);
+    ForEachPosting(*plan.required_terms.front().posting, document_predicate,
+                   [&candidates](const PostingKey& key, TermCount) { candidates.push_back(key); }, stats);
+
+    // в пересечениях списки не обходятся целиком: в статистику идут только совпавшие элементы
+    std::pmr::vector<PostingKey> narrowed(scratch);
+    for (auto it = std::next(plan.required_terms.begin()); it != plan.required_terms.end() && !candidates.empty(); ++it) {
+        narrowed.clear();
+        ForEachIntersection(candidates.begin(), candidates.end(), *it->posting,
+                            [&narrowed](const auto& key_freq) { narrowed.push_back(key_freq.first); });
+        if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+            stats->postings_scanned += narrowed.size();
+        }
+        candidates.swap(narrowed);
+    }
+
+    for (const PlannedTerm& term : plan.minus_terms) {
+        if (candidates.empty()) {
+            break;
+        }
+        narrowed.clear();
+        ForEachIntersection(candidates.begin(), candidates.end(), *term.posting,
+                            [&narrowed](const auto& key_freq) { narrowed.push_back(key_freq.first); });
+        const auto last = std::set_difference(candidates.begin(), candidates.end(), narrowed.begin(), narrowed.end(),
+                                              candidates.begin());
+        if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+            stats->postings_scanned += narrowed.size();
+            stats->excluded_by_minus_words += static_cast<size_t>(candidates.end() - last);
+        }
+        candidates.erase(last, candidates.end());
+    }
+    if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+        stats->documents_scored = candidates.size();
+    }
 
+    // релевантность считаем только для кандидатов; колбэк вызывается по возрастанию ключа.
+    // Срок проверяется только здесь: кандидаты уже содержат все обязательные слова и ни одного минус-слова
+    std::pmr::vector<double> relevances(candidates.size(), 0.0, scratch);
+    for (const PlannedTerm& term : plan.scoring_terms) {
+        if (deadline && deadline->Expired()) {
+            break;
+        }
+        size_t candidate_index = 0;
+        ForEachIntersection(candidates.begin(), candidates.end(), *term.posting,
+                            [&](const auto& key_freq) {
+                                while (candidates[candidate_index] < key_freq.first) {
+                                    ++candidate_index;
+                                }
+                                relevances[candidate_index] += key_freq.second * term.inverse_document_freq;
+                                if constexpr (COLLECTS_QUERY_STATS<Stats>) {
+                                    ++stats->postings_scanned;
+                                }
+                            });
+    }
 
+    DocumentCandidates matched_documents(scratch);
+    matched_documents.reserve(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        matched_documents.push_back(MakeDocument(candidates[i].document_id, relevances[i]));
+    }
+    return matched_documents;
+}
 
+template <typename DocumentPredicate>
+void SearchServer::AddZeroRelevanceDocuments(const QueryPlan& plan, const DocumentPredicate& document_predicate,
+                                             DocumentCandidates& documents, size_t limit) const {
+    if (!plan.matches_all || documents.size() >= limit) {
+        return;
+    }
+    std::pmr::set<int> found_ids(ScratchArena::GetResource());
+    for (const Document& document : documents) {
+        found_ids.insert(document.id);
+    }
+    for (const PostingKey& key : status_index_) {
+        if (found_ids.count(key.document_id) > 0 || !IsAcceptedDocument(key, document_predicate)) {
+            continue;
+        }
+        const bool has_minus_word = std::any_of(plan.minus_terms.begin(), plan.minus_terms.end(),
+                                                [&key](const PlannedTerm& term) { return term.posting->count(key) > 0; });
+        if (!has_minus_word) {
+            documents.push_back({key.document_id, 0.0, GetDocumentRating(key.document_id)});
+        }
+    }
+}
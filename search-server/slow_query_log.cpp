@@ -0,0 +1,157 @@
+#include "slow_query_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+using namespace std::literals;
+
+namespace {
+
+double ToMilliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// длина не больше max_size, по которой текст режется на границе символа UTF-8
+size_t GetTruncatedSize(std::string_view text, size_t max_size) {
+    if (text.size() <= max_size) {
+        return text.size();
+    }
+    size_t size = max_size;
+    while (size > 0 && (static_cast<unsigned char>(text[size]) & 0xC0) == 0x80) {
+        --size; // text[size] продолжает символ, начатый раньше
+    }
+    return size;
+}
+
+} // namespace
+
+static_assert(std::is_trivially_copyable_v<QueryStats>, "слот копируется побайтно");
+
+SlowQueryLog::SlowQueryLog(size_t capacity)
+    : capacity_(capacity)
+    , slots_(std::make_unique<Slot[]>(capacity)) {
+    if (capacity == 0) {
+        throw std::invalid_argument("Журнал медленных запросов должен вмещать хотя бы одну запись.");
+    }
+}
+
+void SlowQueryLog::Add(const SlowQueryRecord& record) {
+    const uint64_t ticket = next_ticket_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[ticket % capacity_];
+    uint64_t version = slot.version.load(std::memory_order_relaxed);
+    if (version % 2 == 1
+            || !slot.version.compare_exchange_strong(version, version + 1, std::memory_order_acquire)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    SlotData& data = slot.data;
+    // писатель со старым билетом мог задержаться, пока кольцо обернулось: более новую запись не затираем
+    if (version != 0 && data.ticket > ticket) {
+        slot.version.store(version + 2, std::memory_order_release);
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    data.ticket = ticket;
+    data.query_size = static_cast<uint16_t>(GetTruncatedSize(record.raw_query, MAX_QUERY_SIZE));
+    std::memcpy(data.query, record.raw_query.data(), data.query_size);
+    data.term_count = static_cast<uint8_t>(std::min(record.terms.size(), MAX_TERMS));
+    for (size_t i = 0; i < data.term_count; ++i) {
+        const SlowQueryRecord::Term& term = record.terms[i];
+        StoredTerm& stored = data.terms[i];
+        stored.word_size = static_cast<uint8_t>(GetTruncatedSize(term.word, MAX_WORD_SIZE));
+        std::memcpy(stored.word, term.word.data(), stored.word_size);
+        stored.is_minus = term.is_minus;
+        stored.is_required = term.is_required;
+        stored.posting_size = term.posting_size;
+    }
+    data.result_count = record.result_count;
+    data.latency_ns = record.latency.count();
+    data.at_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(record.at.time_since_epoch()).count();
+    data.stats = record.stats;
+
+    slot.version.store(version + 2, std::memory_order_release);
+}
+
+std::vector<SlowQueryRecord> SlowQueryLog::Dump() const {
+    std::vector<SlotData> copies;
+    copies.reserve(capacity_);
+    for (size_t i = 0; i < capacity_; ++i) {
+        const Slot& slot = slots_[i];
+        const uint64_t version = slot.version.load(std::memory_order_acquire);
+        if (version == 0 || version % 2 == 1) {
+            continue;
+        }
+        SlotData copy;
+        std::memcpy(&copy, &slot.data, sizeof(SlotData));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) == version) {
+            copies.push_back(copy);
+        }
+    }
+    std::sort(copies.begin(), copies.end(), [](const SlotData& lhs, const SlotData& rhs) {
+        return lhs.ticket < rhs.ticket;
+    });
+
+    std::vector<SlowQueryRecord> records;
+    records.reserve(copies.size());
+    for (const SlotData& data : copies) {
+        SlowQueryRecord& record = records.emplace_back();
+        record.raw_query.assign(data.query, data.query_size);
+        for (size_t i = 0; i < data.term_count; ++i) {
+            const StoredTerm& stored = data.terms[i];
+            record.terms.push_back({std::string(stored.word, stored.word_size), stored.is_minus, stored.is_required,
+                                    static_cast<size_t>(stored.posting_size)});
+        }
+        record.result_count = static_cast<size_t>(data.result_count);
+        record.latency = std::chrono::nanoseconds(data.latency_ns);
+        record.at = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(data.at_ns)));
+        record.stats = data.stats;
+    }
+    return records;
+}
+
+void SlowQueryLog::Write(std::ostream& out) const {
+    const auto flags = out.flags();
+    const auto precision = out.precision(3);
+    out << std::fixed;
+    for (const SlowQueryRecord& record : Dump()) {
+        const QueryStats& stats = record.stats;
+        out << "latency: "sv << ToMilliseconds(record.latency) << " ms, results: "sv << record.result_count
+            << ", query: \""sv << record.raw_query << "\"\n"sv;
+        // нулевое время всех фаз — фазы не мерились
+        if (stats.parse_time + stats.scoring_time + stats.ranking_time > std::chrono::nanoseconds::zero()) {
+            out << "  phases: parse "sv << ToMilliseconds(stats.parse_time) << " ms, scoring "sv
+                << ToMilliseconds(stats.scoring_time) << " ms, ranking "sv << ToMilliseconds(stats.ranking_time)
+                << " ms, plan cached: "sv << (stats.plan_from_cache ? "yes"sv : "no"sv) << '\n';
+        } else {
+            out << "  phases: not measured, plan cached: "sv << (stats.plan_from_cache ? "yes"sv : "no"sv) << '\n';
+        }
+        out
+            << "  postings scanned: "sv << stats.postings_scanned << ", scored: "sv << stats.documents_scored
+            << ", excluded by minus words: "sv << stats.excluded_by_minus_words
+            << ", rejected by predicate: "sv << stats.rejected_by_predicate
+            << ", candidates: "sv << stats.candidates_before_top << '\n'
+            << "  terms:"sv;
+        for (const SlowQueryRecord::Term& term : record.terms) {
+            out << ' ' << (term.is_minus ? "-"sv : term.is_required ? "+"sv : ""sv) << term.word
+                << '(' << term.posting_size << ')';
+        }
+        out << '\n';
+    }
+    out.precision(precision);
+    out.flags(flags);
+}
+
+uint64_t SlowQueryLog::GetAddedCount() const {
+    return next_ticket_.load(std::memory_order_relaxed) - dropped_.load(std::memory_order_relaxed);
+}
+
+uint64_t SlowQueryLog::GetDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
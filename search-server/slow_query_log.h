@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "query_stats.h"
+
+struct SlowQueryRecord {
+    struct Term {
+        std::string word;
+        bool is_minus {false};
+        bool is_required {false};
+        size_t posting_size {0}; // длина списка id слова
+    };
+
+    std::string raw_query;
+    std::vector<Term> terms;
+    size_t result_count {0};
+    std::chrono::nanoseconds latency {0};
+    std::chrono::steady_clock::time_point at;
+    QueryStats stats; // счётчики выполнения и время по фазам
+};
+
+// Ограниченный журнал медленных запросов: кольцо на capacity записей, новые вытесняют старые.
+// Без блокировок: писатель захватывает слот, переводя его счётчик версий в нечётное значение,
+// читатель копирует слот и отбрасывает копию, если версия за это время изменилась.
+// Если слот занят другим писателем или в нём уже запись с более поздним билетом (кольцо обернулось за время записи),
+// запись отбрасывается. Записи хранятся в слотах фиксированного размера: длинный запрос, длинные слова и слова
+// сверх MAX_TERMS обрезаются, текст — по границе символа UTF-8.
+class SlowQueryLog {
+public:
+    static constexpr size_t MAX_QUERY_SIZE = 256;
+    static constexpr size_t MAX_TERMS = 16;
+    static constexpr size_t MAX_WORD_SIZE = 32;
+
+    explicit SlowQueryLog(size_t capacity = 256);
+
+    void Add(const SlowQueryRecord& record);
+
+    // последние записи, от старых к новым; можно вызывать одновременно с Add
+    std::vector<SlowQueryRecord> Dump() const;
+
+    // Dump в читаемом виде: запрос, время по фазам, счётчики и длины списков слов
+    void Write(std::ostream& out) const;
+
+    uint64_t GetAddedCount() const;
+    uint64_t GetDroppedCount() const;
+
+private:
+    struct StoredTerm {
+        char word[MAX_WORD_SIZE];
+        uint8_t word_size;
+        bool is_minus;
+        bool is_required;
+        uint64_t posting_size;
+    };
+
+    struct SlotData {
+        uint64_t ticket; // порядковый номер записи
+        char query[MAX_QUERY_SIZE];
+        uint16_t query_size;
+        StoredTerm terms[MAX_TERMS];
+        uint8_t term_count;
+        uint64_t result_count;
+        int64_t latency_ns;
+        int64_t at_ns;
+        QueryStats stats;
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> version {0}; // 0 — пуст, нечётное — идёт запись
+        SlotData data;
+    };
+
+    size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_ticket_ {0};
+    std::atomic<uint64_t> dropped_ {0};
+};
@@ -22,9 +22,10 @@
 //string to vector<string> ->" "
 //transform_reduce....))) ' '+char
 
-std::vector<std::string_view> SplitIntoWords(std::string_view str) {
-    std::vector<std::string_view> result;
+namespace {
 
+template <typename Container>
+void SplitIntoWordsTo(std::string_view str, Container& result) {
     const int64_t pos_end = str.npos;
     str.remove_prefix(std::min(str.size(), str.find_first_not_of(" ")));
 
@@ -33,7 +34,32 @@ std::vector<std::string_view> SplitIntoWords(std::string_view str) {
         result.push_back(space == pos_end ? str.substr(0) : str.substr(0, space));
         str.remove_prefix(std::min(str.find_first_not_of(" ", space), str.size()));
     }
+}
+
+} // namespace
+
+std::vector<std::string_view> SplitIntoWords(std::string_view str) {
+    std::vector<std::string_view> result;
+    SplitIntoWordsTo(str, result);
+    return result;
+}
 
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view str, std::pmr::memory_resource* resource) {
+    std::pmr::vector<std::string_view> result(resource);
+    SplitIntoWordsTo(str, result);
     return result;
 }
 
+size_t CountWords(std::string_view text) {
+    size_t count = 0;
+    bool in_word = false;
+    for (const char c : text) {
+        if (c == ' ') {
+            in_word = false;
+        } else if (!in_word) {
+            in_word = true;
+            ++count;
+        }
+    }
+    return count;
+}
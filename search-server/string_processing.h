@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <string_view>
@@ -9,6 +10,10 @@
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text); // string_view
 
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource* resource);
+
+size_t CountWords(std::string_view text); // то же разбиение, что и SplitIntoWords, но без аллокаций
+
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
     std::set<std::string, std::less<>> non_empty_strings;
@@ -0,0 +1,59 @@
+#include "synthetic_data.h"
+
+#include <algorithm>
+
+std::string GenerateWord(std::mt19937_64& generator, int max_length) {
+    const int length = std::uniform_int_distribution(1, max_length)(generator);
+    std::string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(static_cast<char>(std::uniform_int_distribution<int>('a', 'z')(generator)));
+    }
+    return word;
+}
+
+std::vector<std::string> GenerateDictionary(std::mt19937_64& generator, int word_count, int max_length) {
+    std::vector<std::string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+std::string GenerateQuery(std::mt19937_64& generator, const std::vector<std::string>& dictionary, int word_count,
+                          double minus_prob) {
+    std::string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (std::uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[std::uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+std::vector<std::string> GenerateQueries(std::mt19937_64& generator, const std::vector<std::string>& dictionary,
+                                         size_t query_count, int max_word_count) {
+    std::vector<std::string> queries;
+    queries.reserve(query_count);
+    for (size_t i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, std::uniform_int_distribution(1, max_word_count)(generator)));
+    }
+    return queries;
+}
+
+std::vector<std::string> GenerateTexts(std::mt19937_64& generator, const std::vector<std::string>& dictionary,
+                                       size_t text_count, int word_count) {
+    std::vector<std::string> texts;
+    texts.reserve(text_count);
+    for (size_t i = 0; i < text_count; ++i) {
+        texts.push_back(GenerateQuery(generator, dictionary, word_count));
+    }
+    return texts;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+// Синтетические слова, тексты и запросы для замеров: один seed генератора — одни и те же данные.
+
+std::string GenerateWord(std::mt19937_64& generator, int max_length);
+
+// слова из букв a-z длиной от 1 до max_length, отсортированы и без повторов
+std::vector<std::string> GenerateDictionary(std::mt19937_64& generator, int word_count, int max_length);
+
+// word_count слов словаря через пробел; каждое с вероятностью minus_prob становится минус-словом
+std::string GenerateQuery(std::mt19937_64& generator, const std::vector<std::string>& dictionary, int word_count,
+                          double minus_prob = 0);
+
+// запросы от 1 до max_word_count слов
+std::vector<std::string> GenerateQueries(std::mt19937_64& generator, const std::vector<std::string>& dictionary,
+                                         size_t query_count, int max_word_count);
+
+// тексты документов ровно по word_count слов
+std::vector<std::string> GenerateTexts(std::mt19937_64& generator, const std::vector<std::string>& dictionary,
+                                       size_t text_count, int word_count);
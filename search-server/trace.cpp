@@ -0,0 +1,221 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+using namespace std::literals;
+
+namespace trace_detail {
+
+std::atomic<bool> enabled {false};
+
+} // namespace trace_detail
+
+namespace {
+
+struct TraceEvent {
+    char name[TRACE_NAME_SIZE];
+    uint8_t name_size;
+    uint32_t thread_id; // буфер переходит к новому потоку, а старые записи остаются за прежним
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+// Кольцо потока-владельца: пишет только он, читают GetTraceRecords и ClearTrace.
+// head_ — номер следующей записи; записи [max(cleared_, head_ - ёмкость), head_) действительны.
+// Когда поток завершается, буфер со своими записями ждёт следующего потока (см. ThreadBufferLease).
+class TraceBuffer {
+public:
+    TraceBuffer()
+        : events_(SLOT_COUNT) {
+    }
+
+    // вызывается под мьютексом реестра, когда буфер достаётся новому потоку
+    void SetThreadId(uint32_t thread_id) {
+        thread_id_ = thread_id;
+    }
+
+    void Push(std::string_view name, int64_t start_ns, int64_t duration_ns) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        // запись номер head затирает запись head - SLOT_COUNT: читатель, увидевший хоть что-то из новой записи,
+        // после своего acquire-барьера увидит и head_ не меньше head и отбросит затираемую
+        std::atomic_thread_fence(std::memory_order_release);
+        TraceEvent& event = events_[head % SLOT_COUNT];
+        event.name_size = static_cast<uint8_t>(std::min(name.size(), TRACE_NAME_SIZE));
+        std::memcpy(event.name, name.data(), event.name_size);
+        event.thread_id = thread_id_;
+        event.start_ns = start_ns;
+        event.duration_ns = duration_ns;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    void Clear() {
+        cleared_.store(head_.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+    void AppendTo(std::vector<TraceRecord>& records) const {
+        const uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t first = std::max(cleared_.load(std::memory_order_relaxed),
+                                  head > TRACE_BUFFER_CAPACITY ? head - TRACE_BUFFER_CAPACITY : 0);
+        std::vector<TraceEvent> copied;
+        copied.reserve(head - first);
+        for (uint64_t i = first; i < head; ++i) {
+            copied.push_back(events_[i % SLOT_COUNT]);
+        }
+        // Пока копировали, владелец мог уйти вперёд и затереть начало: такие записи отбрасываем.
+        // Запись head_after может сейчас писаться поверх head_after - SLOT_COUNT, а та уже старше последних TRACE_BUFFER_CAPACITY.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t head_after = head_.load(std::memory_order_relaxed);
+        const uint64_t overwritten = head_after > TRACE_BUFFER_CAPACITY ? head_after - TRACE_BUFFER_CAPACITY : 0;
+        for (uint64_t i = std::max(first, overwritten); i < head; ++i) {
+            const TraceEvent& event = copied[i - first];
+            records.push_back({std::string(event.name, event.name_size), event.thread_id,
+                               std::chrono::nanoseconds(event.start_ns), std::chrono::nanoseconds(event.duration_ns)});
+        }
+    }
+
+private:
+    // лишняя ячейка — под запись, которая пишется прямо сейчас: читателю всегда доступны TRACE_BUFFER_CAPACITY последних
+    static constexpr uint64_t SLOT_COUNT = TRACE_BUFFER_CAPACITY + 1;
+
+    uint32_t thread_id_ {0};
+    std::vector<TraceEvent> events_;
+    std::atomic<uint64_t> head_ {0};
+    std::atomic<uint64_t> cleared_ {0};
+};
+
+// Буферы переживают свои потоки, чтобы их записи попали в выгрузку, и достаются следующим потокам:
+// буферов не больше, чем потоков трассировало одновременно
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer*> free_buffers; // буферы завершившихся потоков
+    uint32_t next_thread_id {1};
+};
+
+TraceRegistry& GetRegistry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+// Буфер, закреплённый за потоком до его завершения
+class ThreadBufferLease {
+public:
+    ThreadBufferLease() {
+        TraceRegistry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        if (registry.free_buffers.empty()) {
+            registry.buffers.push_back(std::make_unique<TraceBuffer>());
+            buffer_ = registry.buffers.back().get();
+        } else {
+            buffer_ = registry.free_buffers.back();
+            registry.free_buffers.pop_back();
+        }
+        buffer_->SetThreadId(registry.next_thread_id++);
+    }
+
+    ThreadBufferLease(const ThreadBufferLease&) = delete;
+    ThreadBufferLease& operator=(const ThreadBufferLease&) = delete;
+
+    ~ThreadBufferLease() {
+        TraceRegistry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.free_buffers.push_back(buffer_);
+    }
+
+    TraceBuffer& Get() {
+        return *buffer_;
+    }
+
+private:
+    TraceBuffer* buffer_ {nullptr};
+};
+
+TraceBuffer& GetThreadBuffer() {
+    thread_local ThreadBufferLease lease;
+    return lease.Get();
+}
+
+void WriteJsonString(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+namespace trace_detail {
+
+void Record(std::string_view name, int64_t start_ns, int64_t duration_ns) {
+    GetThreadBuffer().Push(name, start_ns, duration_ns);
+}
+
+} // namespace trace_detail
+
+void StartTracing() {
+    trace_detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void StopTracing() {
+    trace_detail::enabled.store(false, std::memory_order_relaxed);
+}
+
+bool IsTracingEnabled() {
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+void ClearTrace() {
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    for (const auto& buffer : registry.buffers) {
+        buffer->Clear();
+    }
+}
+
+size_t GetTraceBufferCount() {
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    return registry.buffers.size();
+}
+
+std::vector<TraceRecord> GetTraceRecords() {
+    std::vector<TraceRecord> records;
+    {
+        TraceRegistry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        for (const auto& buffer : registry.buffers) {
+            buffer->AppendTo(records);
+        }
+    }
+    std::stable_sort(records.begin(), records.end(), [](const TraceRecord& lhs, const TraceRecord& rhs) {
+        return lhs.start < rhs.start;
+    });
+    return records;
+}
+
+void WriteChromeTrace(std::ostream& out) {
+    const std::vector<TraceRecord> records = GetTraceRecords();
+    const auto precision = out.precision(15);
+    out << "{\"traceEvents\": ["sv;
+    bool is_first = true;
+    for (const TraceRecord& record : records) {
+        out << (is_first ? "\n"sv : ",\n"sv) << "{\"name\": "sv;
+        WriteJsonString(out, record.name);
+        // ts и dur в trace-event — микросекунды
+        out << ", \"cat\": \"search\", \"ph\": \"X\", \"pid\": 1, \"tid\": "sv << record.thread_id
+            << ", \"ts\": "sv << record.start.count() / 1000.0 << ", \"dur\": "sv << record.duration.count() / 1000.0 << '}';
+        is_first = false;
+    }
+    out << "\n], \"displayTimeUnit\": \"ns\"}"sv << std::endl;
+    out.precision(precision);
+}
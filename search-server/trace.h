@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Трассировка участков кода для поиска узких мест. В отличие от LogDuration ничего не печатает на месте:
+// участок пишется в кольцевой буфер своего потока (без блокировок, старые записи затираются;
+// буфер завершившегося потока вместе с его записями достаётся следующему),
+// а WriteChromeTrace выгружает все буферы в формат trace-event для chrome://tracing и Perfetto.
+//
+// Выключается при сборке: -DSEARCH_SERVER_TRACING=0 превращает TRACE_SCOPE в пустую инструкцию.
+// Включённая, но не запущенная трассировка стоит одной атомарной загрузки на участок.
+
+#ifndef SEARCH_SERVER_TRACING
+#define SEARCH_SERVER_TRACING 1
+#endif
+
+inline constexpr size_t TRACE_NAME_SIZE = 40;             // длиннее имя обрезается
+inline constexpr size_t TRACE_BUFFER_CAPACITY = 1u << 14; // записей на поток
+
+// Выгруженная запись: участок name потока thread_id, время — от произвольной точки steady_clock
+struct TraceRecord {
+    std::string name;
+    uint32_t thread_id {0};
+    std::chrono::nanoseconds start {0};
+    std::chrono::nanoseconds duration {0};
+};
+
+namespace trace_detail {
+
+extern std::atomic<bool> enabled;
+
+void Record(std::string_view name, int64_t start_ns, int64_t duration_ns);
+
+inline int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace trace_detail
+
+void StartTracing();
+void StopTracing();
+bool IsTracingEnabled();
+
+// Забывает записанное во всех буферах; потоки могут продолжать писать
+void ClearTrace();
+
+// Буферов выделено (по TRACE_BUFFER_CAPACITY записей): буфер завершившегося потока достаётся следующему,
+// поэтому их не больше, чем потоков трассировало одновременно
+size_t GetTraceBufferCount();
+
+// Записи всех потоков по времени начала. Безопасно при пишущих потоках:
+// записи, затёртые во время чтения, отбрасываются.
+std::vector<TraceRecord> GetTraceRecords();
+
+void WriteChromeTrace(std::ostream& out);
+
+// Участок от создания до разрушения. Имя копируется при создании (если трассировка запущена),
+// поэтому подходит и временная строка, как в LOG_DURATION("..."s).
+class TraceScope {
+public:
+    explicit TraceScope(std::string_view name) {
+        if (trace_detail::enabled.load(std::memory_order_relaxed)) {
+            name_size_ = std::min(name.size(), TRACE_NAME_SIZE);
+            std::memcpy(name_, name.data(), name_size_);
+            start_ns_ = trace_detail::Now();
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    ~TraceScope() {
+        if (start_ns_ >= 0) {
+            trace_detail::Record({name_, name_size_}, start_ns_, trace_detail::Now() - start_ns_);
+        }
+    }
+
+private:
+    char name_[TRACE_NAME_SIZE];
+    size_t name_size_ {0};
+    int64_t start_ns_ {-1}; // -1 — трассировка была выключена
+};
+
+#define TRACE_CONCAT_INTERNAL(X, Y) X##Y
+#define TRACE_CONCAT(X, Y) TRACE_CONCAT_INTERNAL(X, Y)
+
+// Как LOG_DURATION(x): участок до конца текущего блока
+#if SEARCH_SERVER_TRACING
+#define TRACE_SCOPE(x) TraceScope TRACE_CONCAT(traceScope, __LINE__)(x)
+#else
+#define TRACE_SCOPE(x) static_cast<void>(0)
+#endif
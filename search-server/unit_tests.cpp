@@ -1,7 +1,25 @@
 #include "unit_tests.h"
+#include "async_search_server.h"
+#include "benchmark.h"
+#include "durable_search_server.h"
+#include "load_generator.h"
+#include "paginator.h"
+#include "process_queries.h"
+#include "query_client.h"
+#include "query_server.h"
+#include "request_queue.h"
 #include "search_server.h"
+#include "trace.h"
 
 #include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
 
 void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func, unsigned line,
                 const std::string& hint) {
@@ -81,6 +99,24 @@ void TestMatchDocument() {
     }
 }
 
+void TestMatchDocumentPolicies() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "big cat and small dog with long fluffy tail near the old house"s, DocumentStatus::BANNED, {1});
+    server.AddDocument(2, "dog"s, DocumentStatus::ACTUAL, {1});
+
+    const std::string query = "dog cat dog mouse tail"s;
+    const auto [seq_words, seq_status] = server.MatchDocument(std::execution::seq, query, 1);
+    const auto [par_words, par_status] = server.MatchDocument(std::execution::par, query, 1);
+    const std::vector<std::string_view> expected = {"cat"sv, "dog"sv, "tail"sv};
+    ASSERT_EQUAL(seq_words, expected);
+    ASSERT_EQUAL(par_words, expected);
+    ASSERT(seq_status == DocumentStatus::BANNED && par_status == DocumentStatus::BANNED);
+
+    ASSERT(std::get<0>(server.MatchDocument("cat -house"s, 1)).empty());
+    ASSERT(std::get<0>(server.MatchDocument(std::execution::par, "cat -house"s, 1)).empty());
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument("cat -house dog"s, 2)).size(), 1u);
+}
+
 void TestSortingRelevance() {
     const std::string content1 = "cat in the city"s;
     const std::string content2 = "dog in the"s;
@@ -139,6 +175,107 @@ void TestFilterWithPredicate() {
     }
 }
 
+void TestDocumentFilter() {
+    SearchServer search_server;
+    search_server.AddDocument(0, "белый кот и модный ошейник"s,        DocumentStatus::ACTUAL,     {8, -3});
+    search_server.AddDocument(1, "пушистый кот пушистый хвост"s,       DocumentStatus::ACTUAL,     {7, 2, 7});
+    search_server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL,     {5, -12, 2, 1});
+    search_server.AddDocument(3, "ухоженный скворец евгений"s,         DocumentStatus::BANNED,     {9});
+    search_server.AddDocument(4, "пушистый кот"s,                      DocumentStatus::IRRELEVANT, {1});
+
+    const std::string query = "пушистый ухоженный кот"s;
+    const auto filter = (DocumentFilter::StatusIn({DocumentStatus::ACTUAL, DocumentStatus::BANNED})
+                         && DocumentFilter::RatingBetween(2, 9))
+                        || DocumentFilter::IdIn({4, 100});
+    auto ids_of = [](const std::vector<Document>& documents) {
+        std::set<int> ids;
+        for (const Document& document : documents) {
+            ids.insert(document.id);
+        }
+        return ids;
+    };
+
+    // тот же фильтр, вызванный как обычный предикат, должен дать то же самое
+    const auto by_predicate = search_server.FindTopDocuments(query,
+            [&filter](int document_id, DocumentStatus status, int rating) { return filter(document_id, status, rating); });
+    const auto by_filter = search_server.FindTopDocuments(query, filter);
+    ASSERT_EQUAL(ids_of(by_filter), (std::set<int>{0, 1, 3, 4}));
+    ASSERT_EQUAL(ids_of(by_predicate), ids_of(by_filter));
+    ASSERT_EQUAL(ids_of(search_server.FindTopDocuments(std::execution::par, query, filter)), ids_of(by_filter));
+    ASSERT_EQUAL(ids_of(search_server.FindTopDocuments(adaptive_policy, query, filter)), ids_of(by_filter));
+
+    ASSERT_EQUAL(ids_of(search_server.FindTopDocuments(query, !DocumentFilter::RatingBetween(2, 9))), (std::set<int>{2, 4}));
+    ASSERT_EQUAL(ids_of(search_server.FindTopDocuments(query, DocumentFilter::IdIn({0, 2, 4})
+                                                              && !DocumentFilter::RatingBetween(2, 9))), (std::set<int>{2, 4}));
+
+    // отрицание статуса обходит только сегменты остальных статусов, не перебирая документы ACTUAL
+    QueryStats stats;
+    ASSERT_EQUAL(ids_of(search_server.FindTopDocuments(query, !DocumentFilter::StatusIn({DocumentStatus::ACTUAL}), stats)),
+                 (std::set<int>{3, 4}));
+    ASSERT_EQUAL(stats.postings_scanned, 3u);
+    ASSERT_EQUAL(stats.rejected_by_predicate, 0u);
+
+    // узкий диапазон рейтингов берётся из индекса рейтингов и пересекается со списками вместо их обхода
+    SearchServer rated;
+    for (int id = 0; id < 100; ++id) {
+        rated.AddDocument(id, "кот"s, DocumentStatus::ACTUAL, {id});
+        rated.AddDocument(id + 100, "пёс"s, DocumentStatus::ACTUAL, {id}); // у слова «кот» ненулевой idf
+    }
+    QueryStats narrow_stats;
+    ASSERT_EQUAL(ids_of(rated.FindTopDocuments("кот"s, DocumentFilter::RatingBetween(10, 12), narrow_stats)),
+                 (std::set<int>{10, 11, 12}));
+    ASSERT_EQUAL(narrow_stats.postings_scanned, 3u);
+    QueryStats wide_stats;
+    ASSERT_EQUAL(rated.FindTopDocuments("кот"s, DocumentFilter::RatingBetween(10, 89), wide_stats).size(),
+                 MAX_RESULT_DOCUMENT_COUNT);
+    ASSERT_EQUAL(wide_stats.postings_scanned, 100u);
+    rated.UpdateDocumentAttributes(50, DocumentStatus::ACTUAL, {11});
+    rated.RemoveDocuments({10, 12});
+    ASSERT_EQUAL(ids_of(rated.FindTopDocuments("кот"s, DocumentFilter::RatingBetween(10, 12))), (std::set<int>{11, 50}));
+
+    search_server.RemoveDocument(1);
+    ASSERT_EQUAL(ids_of(search_server.FindTopDocuments(query, filter)), (std::set<int>{0, 3, 4}));
+}
+
+void TestRequiredWords() {
+    SearchServer search_server("и"s);
+    search_server.AddDocument(0, "белый кот и модный ошейник"s,        DocumentStatus::ACTUAL, {8, -3});
+    search_server.AddDocument(1, "пушистый кот пушистый хвост"s,       DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    search_server.AddDocument(3, "ухоженный кот евгений"s,             DocumentStatus::ACTUAL, {9});
+    search_server.AddDocument(4, "пушистый кот ухоженный"s,            DocumentStatus::BANNED, {9});
+
+    const auto found_docs = search_server.FindTopDocuments("+кот +ухоженный пушистый"s);
+    ASSERT_EQUAL(found_docs.size(), 1u);
+    ASSERT_EQUAL(found_docs[0].id, 3);
+    // релевантность та же, что и без обязательности: IDF считается по всем документам
+    const auto plain_docs = search_server.FindTopDocuments("кот ухоженный пушистый"s, [](int document_id, DocumentStatus, int) {
+        return document_id == 3;
+    });
+    ASSERT(std::abs(found_docs[0].relevance - plain_docs[0].relevance) < 1e-6);
+
+    ASSERT_EQUAL(search_server.FindTopDocuments(std::execution::par, "+кот пушистый"s).size(), 3u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("+кот +пушистый"s, DocumentStatus::BANNED).size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("+кот -белый -хвост"s).size(), 1u);
+    ASSERT(search_server.FindTopDocuments("+кот +собака"s).empty());
+    ASSERT(search_server.FindTopDocuments("+и кот"s).size() == 3u); // стоп-слово игнорируется и с плюсом
+
+    ASSERT(std::get<0>(search_server.MatchDocument("+ухоженный кот"s, 1)).empty());
+    ASSERT_EQUAL(std::get<0>(search_server.MatchDocument("+ухоженный кот"s, 3)).size(), 2u);
+    ASSERT_EQUAL(std::get<0>(search_server.MatchDocument(std::execution::par, "+ухоженный кот"s, 3)).size(), 2u);
+    ASSERT(std::get<0>(search_server.MatchDocument(std::execution::par, "+ухоженный кот"s, 1)).empty());
+
+    for (const std::string& query : {"+"s, "++кот"s, "+-кот"s, "-+кот"s}) {
+        bool thrown = false;
+        try {
+            search_server.FindTopDocuments(query);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, query);
+    }
+}
+
 void TestFindStatus() {
     SearchServer search_server;
     search_server.AddDocument(0, "белый кот и модный ошейник"s,        DocumentStatus::ACTUAL, {8, -3});
@@ -151,6 +288,30 @@ void TestFindStatus() {
                                                                   " Rigth value: found_docs.size() == 1 && found_docs[0].id == 3"s);
 }
 
+void TestFindStatusSegments() {
+    SearchServer search_server;
+    search_server.AddDocument(0, "кот и пёс"s,             DocumentStatus::IRRELEVANT, {1});
+    search_server.AddDocument(1, "кот пушистый"s,          DocumentStatus::ACTUAL,     {2});
+    search_server.AddDocument(2, "кот ухоженный"s,         DocumentStatus::BANNED,     {3});
+    search_server.AddDocument(3, "кот ухоженный пушистый"s, DocumentStatus::BANNED,    {4});
+    search_server.AddDocument(4, "кот"s,                   DocumentStatus::REMOVED,    {5});
+
+    const auto banned = search_server.FindTopDocuments("кот"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(banned.size(), 2u);
+    ASSERT(banned[0].id == 3 && banned[1].id == 2);
+
+    const auto banned_par = search_server.FindTopDocuments(std::execution::par, "кот -пушистый"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(banned_par.size(), 1u);
+    ASSERT_EQUAL(banned_par[0].id, 2);
+
+    ASSERT_EQUAL(search_server.FindTopDocuments("кот"s, DocumentStatus::REMOVED).size(), 1u);
+    search_server.RemoveDocument(4);
+    ASSERT(search_server.FindTopDocuments("кот"s, DocumentStatus::REMOVED).empty());
+    search_server.RemoveDocument(std::execution::par, 0);
+    ASSERT(search_server.FindTopDocuments("кот"s, DocumentStatus::IRRELEVANT).empty());
+    ASSERT_EQUAL(search_server.FindTopDocuments("кот"s).size(), 1u);
+}
+
 void TestComputeRelevance() {
     SearchServer search_server;
 
@@ -178,15 +339,1217 @@ void TestComputeRelevance() {
     ASSERT_HINT(a < EPSILON, "relevance calculation is wrong"s);
     ASSERT_HINT(b < EPSILON, "relevance calculation is wrong"s);
 }
+void TestAdaptiveExecution() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s,          DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "funny pet with curly hair"s,        DocumentStatus::ACTUAL, {1, 2, 3});
+    search_server.AddDocument(3, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2, 8});
+    search_server.AddDocument(4, "pet with rat and rat and rat"s,     DocumentStatus::BANNED, {1, 3, 2});
+    search_server.AddDocument(5, "nasty rat with curly hair"s,        DocumentStatus::ACTUAL, {1, 1, 1});
+
+    const std::string query = "curly nasty pet rat -not"s;
+    const auto expected = search_server.FindTopDocuments(query);
+    auto check_same = [&expected](const std::vector<Document>& found_docs) {
+        ASSERT_EQUAL(found_docs.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(found_docs[i].id, expected[i].id);
+            ASSERT(std::abs(found_docs[i].relevance - expected[i].relevance) < 1e-6);
+        }
+    };
+
+    check_same(search_server.FindTopDocuments(adaptive_policy, query));
+    ASSERT_EQUAL(search_server.GetExecutionPathCount(ExecutionPath::SEQUENTIAL), 1u);
+
+    AdaptiveThresholds thresholds;
+    thresholds.min_parallel_postings = 0;
+    thresholds.range_chunk_size = 2;
+    search_server.SetAdaptiveThresholds(thresholds);
+    check_same(search_server.FindTopDocuments(adaptive_policy, query));
+    ASSERT_EQUAL(search_server.GetExecutionPathCount(ExecutionPath::RANGE_PARALLEL), 1u);
+
+    thresholds.min_word_parallel_words = 1;
+    search_server.SetAdaptiveThresholds(thresholds);
+    check_same(search_server.FindTopDocuments(adaptive_policy, query, DocumentStatus::ACTUAL));
+    ASSERT_EQUAL(search_server.GetExecutionPathCount(ExecutionPath::WORD_PARALLEL), 1u);
+
+    search_server.RemoveDocument(adaptive_policy, 5);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 4);
+    ASSERT_EQUAL(search_server.GetExecutionPathCount(ExecutionPath::SEQUENTIAL), 2u);
+}
+void TestQueryPlan() {
+    SearchServer search_server;
+    search_server.AddDocument(0, "белый кот"s,           DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(1, "пушистый кот"s,        DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(2, "ухоженный кот"s,       DocumentStatus::ACTUAL, {3});
+    search_server.AddDocument(3, "ухоженный белый кот"s, DocumentStatus::BANNED, {4});
+
+    // "кот" есть во всех документах: его список не обходится, но документы с нулевой релевантностью остаются в выдаче
+    const auto found_docs = search_server.FindTopDocuments("кот пушистый -ухоженный"s);
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    ASSERT_EQUAL(found_docs[0].id, 1);
+    ASSERT_EQUAL(found_docs[1].id, 0);
+    ASSERT(found_docs[1].relevance == 0.0);
+    ASSERT_EQUAL(search_server.FindTopDocuments(std::execution::par, "кот"s).size(), 3u);
+
+    const std::string plan = search_server.Explain("пушистый кот -ухоженный"s);
+    ASSERT_HINT(plan.find("strategy: PRUNED"s) != std::string::npos, plan);
+    ASSERT_HINT(plan.find("pruned (idf = 0): кот"s) != std::string::npos, plan);
+    ASSERT_HINT(plan.find("cached: yes"s) != std::string::npos, plan); // тот же набор слов, что и у запроса выше
+
+    // слова упорядочены по частоте: редкие раньше
+    const std::string ordered = search_server.Explain("белый ухоженный пушистый"s);
+    ASSERT_HINT(ordered.find("scoring: пушистый"s) != std::string::npos, ordered);
+    ASSERT_HINT(search_server.Explain("+ухоженный кот"s).find("strategy: INTERSECTION"s) != std::string::npos, ordered);
+
+    // изменение индекса сбрасывает план
+    search_server.AddDocument(4, "пёс"s, DocumentStatus::ACTUAL, {5});
+    const std::string replanned = search_server.Explain("пушистый кот -ухоженный"s);
+    ASSERT_HINT(replanned.find("strategy: EXHAUSTIVE"s) != std::string::npos, replanned);
+    ASSERT_HINT(replanned.find("cached: no"s) != std::string::npos, replanned);
+}
+
+void TestPreparedQuery() {
+    SearchServer search_server;
+    search_server.AddDocument(0, "белый кот"s,    DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(1, "пушистый кот"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(2, "белый пёс"s,    DocumentStatus::BANNED, {3});
+
+    const auto query = search_server.Prepare("белый пушистый -пёс"s);
+    ASSERT_EQUAL(search_server.FindTopDocuments(query).size(), 2u);
+    ASSERT_EQUAL(search_server.FindTopDocuments(std::execution::par, query).size(), 2u);
+    ASSERT_EQUAL(search_server.FindTopDocuments(adaptive_policy, query, DocumentStatus::BANNED).size(), 0u);
+    const auto [words, status] = search_server.MatchDocument(query, 0);
+    ASSERT_EQUAL(words.size(), 1u);
+    ASSERT_EQUAL(words[0], "белый"s);
+
+    // индекс изменился: ссылки на списки и IDF пересчитываются, результат совпадает с обычным запросом
+    search_server.AddDocument(3, "пушистый белый попугай"s, DocumentStatus::ACTUAL, {4});
+    search_server.RemoveDocument(1);
+    const auto found_docs = search_server.FindTopDocuments(query);
+    const auto expected = search_server.FindTopDocuments("белый пушистый -пёс"s);
+    ASSERT_EQUAL(found_docs.size(), expected.size());
+    for (size_t i = 0; i < found_docs.size(); ++i) {
+        ASSERT_EQUAL(found_docs[i].id, expected[i].id);
+        ASSERT(std::abs(found_docs[i].relevance - expected[i].relevance) < 1e-6);
+    }
+
+    // копия сервера имеет свой индекс
+    const SearchServer other = search_server;
+    bool thrown = false;
+    try {
+        other.FindTopDocuments(query);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "запрос, подготовленный другим сервером, должен отклоняться"s);
+}
+void TestScratchArena() {
+    SearchServer search_server("и в"s);
+    for (int id = 0; id < 200; ++id) {
+        search_server.AddDocument(id, "кот номер "s + std::to_string(id % 7) + (id % 3 == 0 ? " пушистый"s : " гладкий"s),
+                                  DocumentStatus::ACTUAL, {id});
+    }
+
+    // повторные запросы идут через сброшенную арену и дают тот же результат
+    const auto expected = search_server.FindTopDocuments("пушистый кот 3 -гладкий"s);
+    for (int i = 0; i < 3; ++i) {
+        const auto seq_docs = search_server.FindTopDocuments("пушистый кот 3 -гладкий"s);
+        const auto par_docs = search_server.FindTopDocuments(std::execution::par, "пушистый кот 3 -гладкий"s);
+        ASSERT_EQUAL(seq_docs.size(), expected.size());
+        ASSERT_EQUAL(par_docs.size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j) {
+            ASSERT_EQUAL(seq_docs[j].id, expected[j].id);
+            ASSERT_EQUAL(par_docs[j].id, expected[j].id);
+        }
+    }
+    ASSERT_EQUAL(ScratchArena::GetDepth(), 0u);
+
+    // запрос внутри открытого Scope не сбрасывает арену внешнего
+    {
+        const ScratchArena::Scope outer;
+        std::pmr::vector<int> outer_data({1, 2, 3}, ScratchArena::GetResource());
+        search_server.FindTopDocuments("+пушистый кот"s);
+        ASSERT_EQUAL(ScratchArena::GetDepth(), 1u);
+        ASSERT_EQUAL(outer_data.back(), 3);
+    }
+
+    // исключение при разборе запроса закрывает Scope
+    try {
+        search_server.FindTopDocuments("кот --пёс"s);
+    } catch (const std::invalid_argument&) {
+    }
+    ASSERT_EQUAL(ScratchArena::GetDepth(), 0u);
+}
+
+void TestMemoryStats() {
+    std::pmr::synchronized_pool_resource pool;
+    SearchServer search_server("и в"s, &pool);
+    ASSERT(search_server.GetMemoryResource() == &pool);
+    ASSERT(search_server.GetMemoryStats().terms > 0); // стоп-слова
+    ASSERT_EQUAL(search_server.GetMemoryStats().postings, 0u);
+
+    search_server.AddDocument(1, "пушистый кот и пушистый хвост"s, DocumentStatus::ACTUAL, {7});
+    search_server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::BANNED, {2});
+    const MemoryStats filled = search_server.GetMemoryStats();
+    ASSERT(filled.terms > 0);
+    ASSERT(filled.postings > 0);
+    ASSERT(filled.forward_index > 0);
+    ASSERT(filled.attributes > 0);
+
+    search_server.FindTopDocuments("пушистый пёс"s);
+    ASSERT(search_server.GetMemoryStats().caches > filled.caches); // план попал в кэш
+
+    // копия считает свою память и не зависит от исходного словаря
+    SearchServer copy = search_server;
+    search_server.RemoveDocument(1);
+    search_server.RemoveDocument(2);
+    const MemoryStats emptied = search_server.GetMemoryStats();
+    ASSERT_EQUAL(emptied.postings, 0u);
+    ASSERT_EQUAL(emptied.forward_index, 0u);
+    ASSERT_EQUAL(emptied.attributes, 0u);
+    ASSERT_EQUAL(copy.GetMemoryStats().postings, filled.postings);
+    ASSERT_EQUAL(copy.GetMemoryStats().forward_index, filled.forward_index);
+
+    const auto [words, status] = copy.MatchDocument("пушистый хвост"s, 1);
+    ASSERT_EQUAL(words.size(), 2u);
+    ASSERT_EQUAL(copy.FindTopDocuments("пёс"s, DocumentStatus::BANNED).size(), 1u);
+}
+
+void TestTermCounts() {
+    SearchServer search_server("и"s);
+    search_server.AddDocument(0, "кот и кот и пёс"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(1, "пёс"s,             DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(2, "попугай"s,         DocumentStatus::ACTUAL, {3});
+
+    const auto& counts = search_server.GetWordCounts(0);
+    ASSERT_EQUAL(counts.size(), 2u);
+    ASSERT_EQUAL(counts.at("кот"sv), 2u);
+    ASSERT_EQUAL(counts.at("пёс"sv), 1u);
+
+    // TF считается по длине без стоп-слов
+    const auto freqs = search_server.GetWordFrequencies(0);
+    ASSERT(std::abs(freqs.at("кот"sv) - 2.0 / 3.0) < 1e-12);
+    ASSERT(std::abs(freqs.at("пёс"sv) - 1.0 / 3.0) < 1e-12);
+    ASSERT(search_server.GetWordFrequencies(42).empty());
+
+    const auto found_docs = search_server.FindTopDocuments("кот пёс"s);
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    const double expected = 2.0 / 3.0 * std::log(3.0) + 1.0 / 3.0 * std::log(3.0 / 2.0);
+    ASSERT_EQUAL(found_docs[0].id, 0);
+    ASSERT(std::abs(found_docs[0].relevance - expected) < 1e-12);
+    ASSERT(std::abs(search_server.FindTopDocuments(std::execution::par, "кот пёс"s)[0].relevance - expected) < 1e-12);
+}
+
+void TestRemoveDocuments() {
+    SearchServer search_server("и в"s);
+    for (int id = 0; id < 60; ++id) {
+        search_server.AddDocument(id, "кот номер "s + std::to_string(id) + (id % 4 == 0 ? " пушистый"s : " гладкий"s),
+                                  static_cast<DocumentStatus>(id % 3), {id});
+    }
+    std::vector<int> removed_ids;
+    for (int id = 0; id < 60; id += 3) {
+        removed_ids.push_back(id);
+    }
+    removed_ids.push_back(3);   // повтор
+    removed_ids.push_back(100); // нет такого документа
+
+    SearchServer expected = search_server;
+    for (const int id : removed_ids) {
+        expected.RemoveDocument(id);
+    }
+    SearchServer by_par = search_server;
+    by_par.RemoveDocuments(std::execution::par, removed_ids);
+    search_server.RemoveDocuments(removed_ids);
+
+    for (const SearchServer* server : {&search_server, &by_par}) {
+        ASSERT_EQUAL(server->GetDocumentCount(), expected.GetDocumentCount());
+        ASSERT(std::equal(server->begin(), server->end(), expected.begin(), expected.end()));
+        ASSERT_EQUAL(server->GetMemoryStats().postings, expected.GetMemoryStats().postings);
+        ASSERT_EQUAL(server->GetMemoryStats().terms, expected.GetMemoryStats().terms); // словарь чистится одинаково
+        for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED}) {
+            const auto found_docs = server->FindTopDocuments("пушистый кот 3 4"s, status);
+            const auto expected_docs = expected.FindTopDocuments("пушистый кот 3 4"s, status);
+            ASSERT_EQUAL(found_docs.size(), expected_docs.size());
+            for (size_t i = 0; i < found_docs.size(); ++i) {
+                ASSERT_EQUAL(found_docs[i].id, expected_docs[i].id);
+            }
+        }
+        // слово удалённого документа больше не находится
+        ASSERT(server->FindTopDocuments("0"s).empty());
+        ASSERT(server->Explain("0"s).find("scoring:\n"s) != std::string::npos);
+    }
+}
+
+void TestUpdateDocument() {
+    const std::vector<std::string> texts = {"белый кот и модный ошейник"s, "пушистый кот пушистый хвост"s,
+                                            "ухоженный пёс выразительные глаза"s, "ухоженный скворец евгений"s};
+    SearchServer search_server("и в на"s);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+
+    // слова выдачи MatchDocument ссылаются на словарь и переживают исчезновение слова из индекса
+    const auto [matched_words, _] = search_server.MatchDocument("выразительные"s, 2);
+
+    search_server.UpdateDocument(1, "пушистый кот и рыжий хвост хвост"s, DocumentStatus::ACTUAL, {8});
+    search_server.UpdateDocument(2, "и в на"s, DocumentStatus::BANNED, {1});
+    ASSERT_EQUAL(matched_words.size(), 1u);
+    ASSERT_EQUAL(matched_words[0], "выразительные"sv);
+    ASSERT(search_server.FindTopDocuments("выразительные"s, DocumentStatus::BANNED).empty());
+
+    SearchServer expected("и в на"s);
+    expected.AddDocument(0, texts[0], DocumentStatus::ACTUAL, {0});
+    expected.AddDocument(1, "пушистый кот и рыжий хвост хвост"s, DocumentStatus::ACTUAL, {8});
+    expected.AddDocument(2, "и в на"s, DocumentStatus::BANNED, {1});
+    expected.AddDocument(3, texts[3], DocumentStatus::ACTUAL, {3});
+
+    for (const std::string& query : {"пушистый рыжий кот"s, "ухоженный хвост"s, "пёс глаза"s}) {
+        const auto found_docs = search_server.FindTopDocuments(query);
+        const auto expected_docs = expected.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(found_docs.size(), expected_docs.size(), query);
+        for (size_t i = 0; i < found_docs.size(); ++i) {
+            ASSERT_EQUAL(found_docs[i].id, expected_docs[i].id);
+            ASSERT_EQUAL(found_docs[i].rating, expected_docs[i].rating);
+            ASSERT(std::abs(found_docs[i].relevance - expected_docs[i].relevance) < 1e-12);
+        }
+    }
+    ASSERT(search_server.GetWordCounts(1) == expected.GetWordCounts(1));
+    ASSERT(search_server.GetWordCounts(2).empty());
+    ASSERT_EQUAL(search_server.FindTopDocuments(""s, DocumentStatus::BANNED).size(), 0u);
+
+    // только атрибуты: документ переходит в другой сегмент и другой рейтинг
+    search_server.UpdateDocumentAttributes(3, DocumentStatus::IRRELEVANT, {10, 20});
+    ASSERT(search_server.FindTopDocuments("скворец"s).empty());
+    const auto irrelevant = search_server.FindTopDocuments("скворец"s, DocumentStatus::IRRELEVANT);
+    ASSERT_EQUAL(irrelevant.size(), 1u);
+    ASSERT_EQUAL(irrelevant[0].rating, 15);
+    ASSERT_EQUAL(search_server.FindTopDocuments("ухоженный"s, DocumentFilter::RatingBetween(3, 3)).size(), 0u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("ухоженный"s,
+                                                DocumentFilter::StatusIn({DocumentStatus::IRRELEVANT})
+                                                && DocumentFilter::RatingBetween(15, 15)).size(), 1u);
+
+    bool thrown = false;
+    try {
+        search_server.UpdateDocument(42, "кот"s, DocumentStatus::ACTUAL, {});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestWriteAheadLog() {
+    const std::string directory = (std::filesystem::temp_directory_path()
+                                   / ("search_server_wal_test_"s + std::to_string(::getpid()))).string();
+    std::filesystem::remove_all(directory);
+
+    const auto assert_same_results = [](const SearchServer& lhs, const SearchServer& rhs) {
+        ASSERT_EQUAL(lhs.GetDocumentCount(), rhs.GetDocumentCount());
+        for (const std::string& query : {"пушистый кот"s, "ухоженный -хвост"s, "скворец пёс"s}) {
+            const auto lhs_docs = lhs.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; });
+            const auto rhs_docs = rhs.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; });
+            ASSERT_EQUAL_HINT(lhs_docs.size(), rhs_docs.size(), query);
+            for (size_t i = 0; i < lhs_docs.size(); ++i) {
+                ASSERT_EQUAL(lhs_docs[i].id, rhs_docs[i].id);
+                ASSERT_EQUAL(lhs_docs[i].rating, rhs_docs[i].rating);
+                ASSERT(std::abs(lhs_docs[i].relevance - rhs_docs[i].relevance) < 1e-12);
+            }
+        }
+    };
+
+    {
+        DurableSearchServer durable(directory, "и в на"s);
+        durable.AddDocuments({{0, "белый кот и модный ошейник", DocumentStatus::ACTUAL, {8, -3}},
+                              {1, "пушистый кот пушистый хвост", DocumentStatus::ACTUAL, {7, 2, 7}},
+                              {2, "ухоженный пёс выразительные глаза", DocumentStatus::BANNED, {5}}});
+        durable.AddDocument(3, "ухоженный скворец евгений"s, DocumentStatus::ACTUAL, {9});
+        durable.RemoveDocument(0);
+        durable.UpdateDocument(1, "пушистый рыжий кот"s, DocumentStatus::ACTUAL, {1});
+        durable.UpdateDocumentAttributes(2, DocumentStatus::ACTUAL, {4});
+        durable.Commit();
+
+        // восстановление только из журнала
+        DurableSearchServer recovered(directory, ""s);
+        ASSERT_EQUAL(recovered.GetReplayedRecordCount(), 7u);
+        assert_same_results(recovered.GetSearchServer(), durable.GetSearchServer());
+
+        // после снимка журнал пуст, следующие изменения пишутся в него заново
+        durable.Snapshot();
+        durable.AddDocument(4, "кот и пёс"s, DocumentStatus::ACTUAL, {3});
+        durable.Commit();
+    }
+    {
+        // недописанная запись в конце журнала отбрасывается
+        std::ofstream wal(directory + "/wal"s, std::ios::binary | std::ios::app);
+        wal << "\x20\x00\x00\x00обрыв"s;
+    }
+    {
+        DurableSearchServer recovered(directory, ""s);
+        ASSERT_EQUAL(recovered.GetReplayedRecordCount(), 1u);
+
+        SearchServer expected("и в на"s);
+        expected.AddDocument(1, "пушистый рыжий кот"s, DocumentStatus::ACTUAL, {1});
+        expected.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {4});
+        expected.AddDocument(3, "ухоженный скворец евгений"s, DocumentStatus::ACTUAL, {9});
+        expected.AddDocument(4, "кот и пёс"s, DocumentStatus::ACTUAL, {3});
+        assert_same_results(recovered.GetSearchServer(), expected);
+
+        // журнал обрезан по последней целой записи, дозапись продолжается за ней
+        recovered.RemoveDocument(4);
+        recovered.Commit();
+    }
+    {
+        DurableSearchServer recovered(directory, ""s);
+        ASSERT_EQUAL(recovered.GetReplayedRecordCount(), 2u);
+        ASSERT_EQUAL(recovered.GetSearchServer().GetDocumentCount(), 3);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+void TestProcessQueriesFlat() {
+    SearchServer search_server("and with"s);
+    int id = 0;
+    for (const std::string& text : {"funny pet and nasty rat"s, "funny pet with curly hair"s,
+                                    "funny pet and not very nasty rat"s, "pet with rat and rat and rat"s,
+                                    "nasty rat with curly hair"s, "curly pet"s, "nasty hair"s}) {
+        search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, {id});
+    }
+    const std::vector<std::string> queries = {"nasty rat -not"s, "dog"s, "funny nasty pet curly hair"s, "curly hair"s};
+
+    const auto expected = ProcessQueries(search_server, queries);
+    const QueryResults results = ProcessQueriesFlat(search_server, queries);
+    ASSERT_EQUAL(results.size(), queries.size());
+    size_t total = 0;
+    size_t index = 0;
+    for (const std::span<const Document> documents : results) {
+        ASSERT_EQUAL_HINT(documents.size(), expected[index].size(), queries[index]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL(documents[i].id, expected[index][i].id);
+            ASSERT(std::abs(documents[i].relevance - expected[index][i].relevance) < 1e-12);
+        }
+        total += documents.size();
+        ++index;
+    }
+    ASSERT(results[1].empty());
+    ASSERT_EQUAL(results.GetDocumentCount(), total);
+
+    const auto joined = ProcessQueriesJoined(search_server, queries);
+    ASSERT_EQUAL(joined.size(), total);
+    ASSERT_EQUAL(joined.front().id, expected.front().front().id);
+    ASSERT_EQUAL(joined.back().id, expected.back().back().id);
+
+    ASSERT_EQUAL(ProcessQueriesFlat(search_server, {}).size(), 0u);
+    // все места заняты
+    const QueryResults full = ProcessQueriesFlat(search_server, {"funny nasty pet curly hair"s, "rat pet hair"s});
+    ASSERT_EQUAL(full.GetDocumentCount(), 2 * MAX_RESULT_DOCUMENT_COUNT);
+    ASSERT_EQUAL(full[1].front().id, ProcessQueries(search_server, {"rat pet hair"s})[0].front().id);
+
+    // поиск в буфер вызывающего: не больше out.size() лучших документов, в порядке выдачи
+    std::vector<Document> out(2);
+    ASSERT_EQUAL(search_server.FindTopDocuments(queries[2], DocumentStatus::ACTUAL, std::span<Document>(out)), 2u);
+    ASSERT_EQUAL(out[0].id, expected[2][0].id);
+    ASSERT_EQUAL(out[1].id, expected[2][1].id);
+    const auto is_even = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+    const auto even = search_server.FindTopDocuments(queries[2], is_even);
+    out.resize(2 * MAX_RESULT_DOCUMENT_COUNT);
+    ASSERT_EQUAL(search_server.FindTopDocuments(queries[2], is_even, std::span<Document>(out)), even.size());
+    for (size_t i = 0; i < even.size(); ++i) {
+        ASSERT_EQUAL(out[i].id, even[i].id);
+    }
+}
+
+void TestDocumentStream() {
+    SearchServer search_server("and with"s);
+    int id = 0;
+    for (const std::string& text : {"funny pet and nasty rat"s, "funny pet with curly hair"s,
+                                    "funny pet and not very nasty rat"s, "pet with rat and rat and rat"s,
+                                    "nasty rat with curly hair"s, "curly pet"s, "nasty hair"s}) {
+        search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, {id});
+    }
+    const std::vector<std::string> queries = {"nasty rat -not"s, "dog"s, "cat"s, "funny nasty pet curly hair"s,
+                                              "curly hair"s, "dog"s};
+    const auto expected = ProcessQueries(search_server, queries);
+    const auto joined = ProcessQueriesJoined(search_server, queries);
+
+    std::vector<size_t> expected_query_indexes;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        expected_query_indexes.insert(expected_query_indexes.end(), expected[i].size(), i);
+    }
+
+    // пакеты по два запроса, второй пакет целиком пустой
+    DocumentStream stream(search_server, queries, 2);
+    std::vector<Document> streamed;
+    for (auto it = stream.begin(); it != stream.end(); ++it) {
+        ASSERT_EQUAL(stream.GetQueryIndex(), expected_query_indexes[streamed.size()]);
+        streamed.push_back(*it);
+    }
+    ASSERT_EQUAL(streamed.size(), joined.size());
+    for (size_t i = 0; i < joined.size(); ++i) {
+        ASSERT_EQUAL(streamed[i].id, joined[i].id);
+    }
+
+    // страницы по потоку строятся по мере чтения
+    DocumentStream paged_stream(search_server, queries, 4);
+    size_t page_count = 0;
+    size_t document_count = 0;
+    for (const auto& page : Paginate(paged_stream, 3)) {
+        ASSERT(page.size() == 3 || document_count + page.size() == joined.size());
+        for (const Document& document : page) {
+            ASSERT_EQUAL(document.id, joined[document_count++].id);
+        }
+        ++page_count;
+    }
+    ASSERT_EQUAL(document_count, joined.size());
+    ASSERT_EQUAL(page_count, (joined.size() + 2) / 3);
+
+    const auto pages = Paginate(joined, 4);
+    ASSERT_EQUAL(pages.size(), (joined.size() + 3) / 4);
+    ASSERT_EQUAL((*pages.begin()).size(), 4u);
+
+    const std::vector<std::string> no_results = {"dog"s, "cat"s};
+    DocumentStream empty_stream(search_server, no_results, 1);
+    ASSERT(empty_stream.begin() == empty_stream.end());
+}
+
+void TestSearchCursor() {
+    SearchServer search_server("и в на"s);
+    const std::vector<std::string> words = {"кот"s, "пёс"s, "скворец"s, "хвост"s};
+    for (int id = 0; id < 40; ++id) {
+        // много документов с равными релевантностью и рейтингом: порядок между ними задаёт id
+        std::string text = "зверь "s + words[id % words.size()] + " "s + words[(id / 3) % words.size()];
+        search_server.AddDocument(id, text, id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {id % 3});
+    }
+
+    for (const std::string& query : {"кот хвост"s, "пёс -скворец"s, "зверь"s, "зверь кот"s}) {
+        const auto all = search_server.FindTopDocuments(query, SearchCursor(), std::numeric_limits<size_t>::max());
+        for (size_t i = 1; i < all.size(); ++i) {
+            ASSERT(IsRankedBefore(all[i - 1], all[i]));
+        }
+        const auto first_page = search_server.FindTopDocuments(query, SearchCursor());
+        const auto top = search_server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(first_page.size(), top.size(), query);
+        for (size_t i = 0; i < top.size(); ++i) {
+            ASSERT_EQUAL(first_page[i].id, top[i].id);
+        }
+
+        // страницы по 3 через токен дают ту же выдачу без пропусков и повторов
+        std::vector<Document> paged;
+        std::string token;
+        while (true) {
+            const auto page = search_server.FindTopDocuments(query, SearchCursor::Parse(token), 3);
+            if (page.empty()) {
+                break;
+            }
+            ASSERT(page.size() <= 3u);
+            paged.insert(paged.end(), page.begin(), page.end());
+            token = SearchCursor(page.back()).ToString();
+        }
+        ASSERT_EQUAL_HINT(paged.size(), all.size(), query);
+        for (size_t i = 0; i < all.size(); ++i) {
+            ASSERT_EQUAL(paged[i].id, all[i].id);
+            ASSERT_EQUAL(paged[i].relevance, all[i].relevance);
+        }
+    }
+    // "зверь" есть во всех документах: выдача из одних нулевых документов, их тоже можно листать
+    ASSERT_EQUAL(search_server.FindTopDocuments("зверь"s, SearchCursor(), 100).size(), 32u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("зверь"s, DocumentStatus::BANNED, SearchCursor(), 100).size(), 8u);
+
+    for (const std::string& token : {"x"s, "1:2"s, "1:2:3:4"s, "1:2:z"s}) {
+        bool thrown = false;
+        try {
+            SearchCursor::Parse(token);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, token);
+    }
+}
+
+void TestAsyncSearchServer() {
+    using namespace std::chrono_literals;
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8, -3});
+    search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    search_server.AddDocument(3, "ухоженный скворец евгений"s, DocumentStatus::BANNED, {9});
+
+    // срок уже истёк: ни одно плюс-слово не обойдено
+    const auto expired = search_server.FindTopDocumentsWithDeadline("пушистый кот"s, DocumentStatus::ACTUAL,
+                                                                    std::chrono::steady_clock::now() - 1s);
+    ASSERT(expired.truncated);
+    ASSERT(expired.documents.empty());
+    const auto in_time = search_server.FindTopDocumentsWithDeadline("пушистый кот"s, DocumentStatus::ACTUAL,
+                                                                    std::chrono::steady_clock::now() + 1h);
+    ASSERT(!in_time.truncated);
+    const auto expected = search_server.FindTopDocuments("пушистый кот"s);
+    ASSERT_EQUAL(in_time.documents.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(in_time.documents[i].id, expected[i].id);
+    }
+
+    AsyncSearchServer::Options options;
+    options.thread_count = 1;
+    options.queue_capacity = 1;
+    options.default_timeout = 1h;
+    AsyncSearchServer async_server(search_server, options);
+
+    // единственный поток занят запросом, ждущим сигнала из предиката
+    std::promise<void> started;
+    std::promise<void> release;
+    const std::shared_future<void> released = release.get_future().share();
+    auto blocking = async_server.FindTopDocumentsAsync("кот"s,
+        [&started, released, first = std::make_shared<bool>(true)](int, DocumentStatus, int) {
+            if (*first) {
+                *first = false;
+                started.set_value();
+                released.wait();
+            }
+            return true;
+        }, AsyncSearchServer::Clock::now() + 1h);
+    started.get_future().wait();
+
+    auto queued = async_server.FindTopDocumentsAsync("ухоженный"s, DocumentStatus::ACTUAL, AsyncSearchServer::Clock::now() + 1ms);
+    auto rejected = async_server.FindTopDocumentsAsync("пёс"s);
+    bool thrown = false;
+    try {
+        rejected.get();
+    } catch (const QueryRejected&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    std::this_thread::sleep_for(5ms);
+    release.set_value();
+    ASSERT_EQUAL(blocking.get().documents.size(), 2u);
+    const auto queued_result = queued.get(); // срок истёк, пока запрос стоял в очереди
+    ASSERT(queued_result.truncated);
+    ASSERT(queued_result.documents.empty());
+
+    const auto result = async_server.FindTopDocumentsAsync("пушистый кот"s).get();
+    ASSERT(!result.truncated);
+    ASSERT_EQUAL(result.documents.size(), expected.size());
+    ASSERT_EQUAL(result.documents.front().id, expected.front().id);
+
+    auto invalid = async_server.FindTopDocumentsAsync("кот --хвост"s);
+    thrown = false;
+    try {
+        invalid.get();
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    const AsyncSearchServer::Stats stats = async_server.GetStats();
+    ASSERT_EQUAL(stats.accepted, 4u);
+    ASSERT_EQUAL(stats.rejected, 1u);
+    ASSERT_EQUAL(stats.expired_in_queue, 1u);
+    ASSERT_EQUAL(stats.truncated, 0u);
+}
+
+void TestInterleavedExecution() {
+    SearchServer search_server("и в на"s);
+    const std::vector<std::string> words = {"кот"s, "пёс"s, "скворец"s, "хвост"s, "ошейник"s, "глаза"s, "белый"s};
+    for (int id = 0; id < 60; ++id) {
+        std::string text;
+        for (int i = 0; i <= id % 5; ++i) {
+            text += words[(id * 7 + i * 3) % words.size()] + " "s;
+        }
+        search_server.AddDocument(id, text, id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {id % 4});
+    }
+    // строки документов с большим id читаются из documents_, а не из плотного массива
+    search_server.AddDocument(1'000'000, "белый кот хвост"s, DocumentStatus::ACTUAL, {9});
+    search_server.AddDocument(70, "ёж"s, DocumentStatus::ACTUAL, {1});
+    const std::vector<std::string> queries = {"кот хвост"s, "пёс -глаза"s, "+белый кот"s, "и в"s, "лис"s,
+                                              "кот пёс скворец хвост ошейник глаза белый"s, "-кот"s, "+кот +хвост -пёс"s,
+                                              "ёж"s, "кот -ёж"s};
+
+    const auto check_queries = [&search_server, &queries] {
+        for (const size_t group_size : {size_t{1}, size_t{3}, size_t{16}}) {
+            const auto interleaved = search_server.FindTopDocumentsInterleaved(queries, group_size);
+            const auto processed = ProcessQueriesInterleaved(search_server, queries, group_size);
+            ASSERT_EQUAL(interleaved.size(), queries.size());
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const auto expected = search_server.FindTopDocuments(queries[i]);
+                ASSERT_EQUAL_HINT(interleaved[i].size(), expected.size(), queries[i]);
+                ASSERT_EQUAL_HINT(processed[i].size(), expected.size(), queries[i]);
+                for (size_t j = 0; j < expected.size(); ++j) {
+                    ASSERT_EQUAL(interleaved[i][j].id, expected[j].id);
+                    ASSERT_EQUAL(interleaved[i][j].relevance, expected[j].relevance);
+                    ASSERT_EQUAL(interleaved[i][j].rating, expected[j].rating);
+                    ASSERT_EQUAL(processed[i][j].id, expected[j].id);
+                }
+            }
+        }
+    };
+    check_queries();
+
+    // копии списков устаревают вместе с индексом
+    search_server.UpdateDocument(1, "кот кот кот ёж"s, DocumentStatus::ACTUAL, {100});
+    search_server.UpdateDocumentAttributes(7, DocumentStatus::ACTUAL, {50});
+    search_server.RemoveDocument(70);
+    check_queries();
+
+    bool thrown = false;
+    try {
+        search_server.FindTopDocumentsInterleaved(std::vector<std::string>{"кот"s, "--хвост"s});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestQueryServer() {
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8, -3});
+    search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    search_server.AddDocument(3, "ухоженный скворец евгений"s, DocumentStatus::BANNED, {9});
+
+    const std::string socket_path = (std::filesystem::temp_directory_path()
+                                     / ("search_server_test_"s + std::to_string(::getpid()) + ".sock"s)).string();
+    for (const bool use_unix : {true, false}) {
+        QueryServer::Options options;
+        options.unix_path = use_unix ? socket_path : ""s;
+        options.max_batch_size = 2;
+        QueryServer server(search_server, options);
+        std::thread loop([&server] { server.Run(); });
+
+        QueryClient client = use_unix ? QueryClient::ConnectUnix(socket_path) : QueryClient::ConnectTcp(server.GetPort());
+        // три запроса без ожидания ответов: первые два уходят пакетом, третий — по окну
+        const uint32_t actual_id = client.Send("пушистый ухоженный кот"s);
+        const uint32_t banned_id = client.Send("ухоженный"s, DocumentStatus::BANNED);
+        const uint32_t invalid_id = client.Send("кот --хвост"s);
+        std::map<uint32_t, QueryResponse> responses;
+        for (int i = 0; i < 3; ++i) {
+            QueryResponse response = client.Receive();
+            responses[response.request_id] = std::move(response);
+        }
+        const auto expected = search_server.FindTopDocuments("пушистый ухоженный кот"s);
+        ASSERT(responses.at(actual_id).ok);
+        ASSERT_EQUAL(responses.at(actual_id).documents.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(responses.at(actual_id).documents[i].id, expected[i].id);
+            ASSERT_EQUAL(responses.at(actual_id).documents[i].relevance, expected[i].relevance);
+            ASSERT_EQUAL(responses.at(actual_id).documents[i].rating, expected[i].rating);
+        }
+        ASSERT_EQUAL(responses.at(banned_id).documents.size(), 1u);
+        ASSERT_EQUAL(responses.at(banned_id).documents[0].id, 3);
+        ASSERT(!responses.at(invalid_id).ok);
+        ASSERT(!responses.at(invalid_id).error.empty());
+
+        LoadOptions load;
+        load.unix_path = options.unix_path;
+        load.port = server.GetPort();
+        load.connections = 2;
+        load.requests_per_connection = 50;
+        load.pipeline_depth = 4;
+        LoadReport report = RunQueryLoad(load, {"кот"s, "пёс -глаза"s, "скворец"s});
+        ASSERT_EQUAL(report.requests, 100u);
+        ASSERT_EQUAL(report.errors, 0u);
+        ASSERT(report.latencies.GetPercentile(50) <= report.latencies.GetPercentile(99));
+        ASSERT(report.latencies.GetPercentile(99) <= report.latencies.GetMax());
+
+        server.Stop();
+        loop.join();
+        const QueryServer::Stats stats = server.GetStats();
+        ASSERT_EQUAL(stats.requests, 103u);
+        ASSERT_EQUAL(stats.errors, 1u);
+        ASSERT_EQUAL(stats.connections, 3u);
+    }
+    ASSERT(!std::filesystem::exists(socket_path));
+}
+
+void TestLoadGenerator() {
+    const std::vector<std::string> texts = {
+        "кот кот кот пёс пёс скворец"s,
+        "кот пёс ошейник"s,
+        "кот хвост"s,
+    };
+    SearchServer search_server(""s);
+    SearchServer with_stop_words("кот"s);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1});
+        with_stop_words.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1});
+    }
+    const std::vector<std::string> ranked = RankWordsByFrequency(search_server);
+    ASSERT_EQUAL(ranked, (std::vector<std::string>{"кот"s, "пёс"s, "ошейник"s, "скворец"s, "хвост"s}));
+    // стоп-слов нет в индексе, значит, нет и в запросах
+    ASSERT_EQUAL(RankWordsByFrequency(with_stop_words), (std::vector<std::string>{"пёс"s, "ошейник"s, "скворец"s, "хвост"s}));
+
+    const auto queries = GenerateZipfQueries(ranked, 1000, 2, 1.0, 7);
+    ASSERT_EQUAL(queries, GenerateZipfQueries(ranked, 1000, 2, 1.0, 7));
+    std::map<std::string, size_t> word_counts;
+    for (const std::string& query : queries) {
+        ASSERT(!query.empty());
+        for (const std::string_view word : SplitIntoWords(query)) {
+            ++word_counts[std::string(word)];
+        }
+    }
+    ASSERT(word_counts["кот"s] > word_counts["пёс"s]);
+    ASSERT(word_counts["пёс"s] > word_counts["хвост"s]);
+
+    ReplayOptions options;
+    options.threads = 3;
+    options.requests = 300;
+    ReplayReport closed = RunReplay(search_server, {"кот"s, "пёс -хвост"s, "кот --пёс"s}, options);
+    ASSERT_EQUAL(closed.requests, 300u);
+    ASSERT_EQUAL(closed.errors, 100u);
+    ASSERT(closed.latencies.GetPercentile(50) <= closed.latencies.GetPercentile(99.9));
+    ASSERT(closed.latencies.GetPercentile(99.9) <= closed.latencies.GetMax());
+
+    // открытый цикл не обгоняет заданный темп: 50 запросов по 1000 в секунду — не меньше 49 мс
+    options.requests = 50;
+    options.target_qps = 1000.0;
+    ReplayReport open = RunReplay(search_server, queries, options);
+    ASSERT_EQUAL(open.requests, 50u);
+    ASSERT(open.elapsed >= std::chrono::milliseconds(49));
+
+    std::ostringstream json;
+    PrintReplayReportJson(json, open, options);
+    for (const std::string& key : {"\"mode\": \"open\""s, "\"qps\""s, "\"p50\""s, "\"p90\""s, "\"p99\""s, "\"p99.9\""s}) {
+        ASSERT_HINT(json.str().find(key) != std::string::npos, key);
+    }
+}
+
+void TestBenchmarkSuite() {
+    const BenchmarkStats stats = ComputeBenchmarkStats({4.0, 1.0, 3.0, 2.0});
+    ASSERT_EQUAL(stats.min, 1.0);
+    ASSERT_EQUAL(stats.median, 2.5);
+    ASSERT_EQUAL(stats.mean, 2.5);
+    ASSERT_EQUAL(stats.max, 4.0);
+    ASSERT(std::abs(stats.stddev - std::sqrt(5.0 / 3.0)) < 1e-12);
+
+    // тело вызывается один раз вхолостую и затем на каждый повтор; фильтр отбирает по подстроке имени
+    BenchmarkSuite suite;
+    int fast_calls = 0;
+    int slow_calls = 0;
+    suite.Add("Fast/items=10"s, 10, [&fast_calls](BenchmarkTimer& timer) {
+        ++fast_calls;
+        timer.Measure([] {});
+    }, 4);
+    suite.Add("Slow/items=1"s, 1, [&slow_calls](BenchmarkTimer& timer) {
+        ++slow_calls;
+        timer.Measure([] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    });
+    const std::vector<BenchmarkResult> results = suite.Run(3, "Slow"sv);
+    ASSERT_EQUAL(fast_calls, 0);
+    ASSERT_EQUAL(slow_calls, 4);
+    ASSERT_EQUAL(results.size(), 1u);
+    ASSERT_EQUAL(results[0].repetitions, 3u);
+    ASSERT(results[0].stats.min >= 0.001);
+
+    std::stringstream json;
+    WriteBenchmarkJson(json, suite.Run(2));
+    const std::vector<BenchmarkResult> baseline = ReadBenchmarkJson(json);
+    ASSERT_EQUAL(baseline.size(), 2u);
+    ASSERT_EQUAL(baseline[0].name, "Fast/items=10"s);
+    ASSERT_EQUAL(baseline[0].items, 10u);
+    ASSERT_EQUAL(baseline[0].threads, 4u);
+    ASSERT_EQUAL(baseline[1].threads, 1u);
+    ASSERT_EQUAL(baseline[1].repetitions, 2u);
+    // пропускная способность на поток: 10 операций за 0.5 с на 4 потоках
+    BenchmarkResult parallel {"Parallel"s, 10, 1, {}, 4};
+    parallel.stats.median = 0.5;
+    ASSERT(std::abs(parallel.GetItemsPerSecondPerThread() - 5.0) < 1e-12);
+
+    // замедление считается по медиане и только сверх порога; замера без базы нет среди замедлений
+    std::vector<BenchmarkResult> current = baseline;
+    current[1].stats.median = baseline[1].stats.median * 1.5;
+    current.push_back({"New"s, 1, 1, {}});
+    std::ostringstream report;
+    ASSERT_EQUAL(CompareBenchmarks(report, current, baseline, 0.1), 1u);
+    ASSERT_EQUAL(CompareBenchmarks(report, current, baseline, 0.6), 0u);
+
+    bool thrown = false;
+    try {
+        suite.Add("bad\"name"s, 1, [](BenchmarkTimer&) {});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestQueryStats() {
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8, -3});
+    search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    search_server.AddDocument(3, "ухоженный скворец евгений"s, DocumentStatus::BANNED, {9});
+
+    const std::string query = "пушистый ухоженный кот -ошейник -слон"s;
+    QueryStats stats;
+    const auto documents = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, stats);
+    ASSERT_EQUAL(documents.size(), search_server.FindTopDocuments(query).size());
+    ASSERT_EQUAL(documents[0].id, search_server.FindTopDocuments(query)[0].id);
+    ASSERT_EQUAL(stats.terms_resolved, 4u);
+    // сегмент ACTUAL: пушистый {1}, ухоженный {2}, кот {0, 1}, минус ошейник {0}
+    ASSERT_EQUAL(stats.postings_scanned, 5u);
+    ASSERT_EQUAL(stats.rejected_by_predicate, 0u);
+    ASSERT_EQUAL(stats.documents_scored, 3u);
+    ASSERT_EQUAL(stats.excluded_by_minus_words, 1u);
+    ASSERT_EQUAL(stats.candidates_before_top, 2u);
+    ASSERT(!stats.plan_from_cache);
+
+    // произвольный предикат проходит списки целиком; статистика перезаписывается, а не копится
+    search_server.FindTopDocuments(query, [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; }, stats);
+    ASSERT(stats.plan_from_cache);
+    ASSERT_EQUAL(stats.postings_scanned, 6u);
+    ASSERT_EQUAL(stats.rejected_by_predicate, 3u);
+    ASSERT_EQUAL(stats.documents_scored, 2u);
+    ASSERT_EQUAL(stats.excluded_by_minus_words, 1u);
+    ASSERT_EQUAL(stats.candidates_before_top, 1u);
+
+    // обязательное слово: кандидаты из списка «кот», затем вклады пушистый {1} и кот {0, 1}
+    search_server.FindTopDocuments("+кот пушистый"s, DocumentStatus::ACTUAL, stats);
+    ASSERT_EQUAL(stats.postings_scanned, 5u);
+    ASSERT_EQUAL(stats.documents_scored, 2u);
+    ASSERT_EQUAL(stats.candidates_before_top, 2u);
+
+    const auto [excluded_words, excluded_status] = search_server.MatchDocument("пушистый кот -ошейник"s, 0, stats);
+    ASSERT(excluded_words.empty());
+    ASSERT_EQUAL(stats.terms_resolved, 3u);
+    ASSERT_EQUAL(stats.excluded_by_minus_words, 1u);
+    ASSERT_EQUAL(stats.documents_scored, 0u);
+    const auto [matched_words, matched_status] = search_server.MatchDocument("пушистый кот -ошейник"s, 1, stats);
+    ASSERT_EQUAL(matched_words.size(), 2u);
+    ASSERT_EQUAL(stats.excluded_by_minus_words, 0u);
+    ASSERT_EQUAL(stats.documents_scored, 1u);
+    ASSERT_EQUAL(stats.postings_scanned, 0u);
+}
+
+void TestTracing() {
+    const auto count_records = [](std::string_view name) {
+        const auto records = GetTraceRecords();
+        return std::count_if(records.begin(), records.end(), [name](const TraceRecord& record) { return record.name == name; });
+    };
+
+    ClearTrace();
+    {
+        TraceScope scope("выключено"sv);
+    }
+    ASSERT_EQUAL(count_records("выключено"sv), 0);
+
+    StartTracing();
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8, -3});
+    search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    ProcessQueries(search_server, {"кот"s, "пушистый хвост"s, "ошейник"s});
+    {
+        TraceScope scope("временное имя"s); // имя копируется, временная строка может умереть раньше участка
+    }
+    StopTracing();
+#if SEARCH_SERVER_TRACING
+    ASSERT_EQUAL(count_records("AddDocument"sv), 2);
+    ASSERT_EQUAL(count_records("ProcessQueries/query"sv), 3);
+    ASSERT_EQUAL(count_records("FindTopDocuments"sv), 3);
+    ASSERT_EQUAL(count_records("FindAllDocuments"sv), 3);
+#endif
+    ASSERT_EQUAL(count_records("временное имя"sv), 1);
+
+    // кольцо хранит последние TRACE_BUFFER_CAPACITY записей потока
+    ClearTrace();
+    StartTracing();
+    for (size_t i = 0; i < TRACE_BUFFER_CAPACITY + 100; ++i) {
+        TraceScope scope("кольцо"sv);
+    }
+    std::thread([] { TraceScope scope("другой поток"sv); }).join();
+    StopTracing();
+    ASSERT_EQUAL(count_records("кольцо"sv), static_cast<std::ptrdiff_t>(TRACE_BUFFER_CAPACITY));
+    ASSERT_EQUAL(count_records("другой поток"sv), 1);
+
+    const auto records = GetTraceRecords();
+    ASSERT(std::is_sorted(records.begin(), records.end(), [](const TraceRecord& lhs, const TraceRecord& rhs) {
+        return lhs.start < rhs.start;
+    }));
+    ASSERT(records.back().thread_id != records.front().thread_id);
+
+    // буфер завершившегося потока достаётся следующему: короткие потоки не копят память
+    const size_t buffer_count = GetTraceBufferCount();
+    StartTracing();
+    for (int i = 0; i < 20; ++i) {
+        std::thread([] { TraceScope scope("короткий поток"sv); }).join();
+    }
+    StopTracing();
+    ASSERT_EQUAL(GetTraceBufferCount(), buffer_count);
+    ASSERT_EQUAL(count_records("короткий поток"sv), 20);
+    ASSERT_EQUAL(count_records("другой поток"sv), 1);
+
+    std::ostringstream json;
+    WriteChromeTrace(json);
+    ASSERT(json.str().starts_with("{\"traceEvents\": ["s));
+    ASSERT(json.str().find("\"name\": \"другой поток\", \"cat\": \"search\", \"ph\": \"X\""s) != std::string::npos);
+    ClearTrace();
+    ASSERT(GetTraceRecords().empty());
+}
+
+void TestRequestQueueStats() {
+    // корзина гистограммы не шире 1/128 своего значения: ошибка меньше 1%
+    static_assert(LatencyHistogram::SUB_BUCKET_COUNT >= 100);
+    for (const int64_t value : {0, 7, 8, 15, 16, 127, 128, 129, 255, 256, 1000, 123456, 999999999}) {
+        const size_t index = LatencyHistogram::GetBucketIndex(std::chrono::nanoseconds(value));
+        const uint64_t upper = LatencyHistogram::GetBucketUpperBound(index);
+        ASSERT(upper >= static_cast<uint64_t>(value));
+        ASSERT(upper - value <= static_cast<uint64_t>(value) / LatencyHistogram::SUB_BUCKET_COUNT);
+        ASSERT(index == 0 || LatencyHistogram::GetBucketUpperBound(index - 1) < static_cast<uint64_t>(value));
+    }
+    // перцентили известного распределения: 1, 2, ..., 1000 мкс
+    const auto histogram = std::make_unique<LatencyHistogram>();
+    for (int i = 1; i <= 1000; ++i) {
+        histogram->Record(std::chrono::microseconds(i));
+    }
+    for (const auto& [percentile, expected] : {std::pair{50.0, 500}, {90.0, 900}, {99.0, 990}, {99.9, 999}, {100.0, 1000}}) {
+        const auto actual = histogram->GetPercentile(percentile);
+        ASSERT(actual >= std::chrono::microseconds(expected));
+        ASSERT(actual - std::chrono::microseconds(expected) <= std::chrono::microseconds(expected) / 100);
+    }
+
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8, -3});
+    search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "ухоженный скворец евгений"s, DocumentStatus::BANNED, {9});
+
+    // прежний счётчик пустых ответов за последние 1440 запросов, теперь из нескольких потоков
+    RequestQueue request_queue(search_server);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&request_queue] {
+            for (int j = 0; j < 1000; ++j) {
+                request_queue.AddFindRequest("пустой запрос"s);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1440);
+    request_queue.AddFindRequest("пушистый кот"s);
+    request_queue.AddFindRequest("скворец"s, DocumentStatus::BANNED);
+    request_queue.AddFindRequest("кот"s, [](int document_id, DocumentStatus, int) { return document_id == 0; });
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1437);
+    const RequestQueue::WindowStats all = request_queue.GetStats();
+    ASSERT_EQUAL(all.requests, 4003u);
+    ASSERT_EQUAL(all.empty_results, 4000u);
+    ASSERT_EQUAL(request_queue.GetStats(RequestQueue::RequestClass::BANNED).requests, 1u);
+    ASSERT_EQUAL(request_queue.GetStats(RequestQueue::RequestClass::PREDICATE).empty_results, 0u);
+
+    // скользящее окно 10 с из 10 слотов: время задаётся явно
+    RequestQueue::Options options;
+    options.window = std::chrono::seconds(10);
+    options.slot_count = 10;
+    options.shard_count = 4;
+    RequestQueue windowed(search_server, options);
+    const auto t0 = RequestQueue::Clock::now();
+    using RequestClass = RequestQueue::RequestClass;
+    for (int i = 0; i < 10; ++i) {
+        windowed.RecordRequest(RequestClass::ACTUAL, i < 2 ? 0 : 5, std::chrono::milliseconds(1), t0);
+    }
+    for (int i = 0; i < 5; ++i) {
+        windowed.RecordRequest(RequestClass::BANNED, 1, std::chrono::microseconds(100), t0);
+    }
+    const auto actual = windowed.GetStats(RequestClass::ACTUAL, t0 + std::chrono::seconds(5));
+    ASSERT_EQUAL(actual.requests, 10u);
+    ASSERT_EQUAL(actual.empty_results, 2u);
+    ASSERT(std::abs(actual.empty_result_rate - 0.2) < 1e-9);
+    ASSERT(actual.p50 >= std::chrono::milliseconds(1) && actual.p50 <= std::chrono::microseconds(1125));
+    ASSERT(actual.p50 <= actual.p90 && actual.p90 <= actual.p99 && actual.p99 <= actual.p999 && actual.p999 <= actual.max);
+    const auto both = windowed.GetStats(t0 + std::chrono::seconds(5));
+    ASSERT_EQUAL(both.requests, 15u);
+    ASSERT(both.p50 <= std::chrono::microseconds(1125) && both.p50 >= std::chrono::milliseconds(1));
+    ASSERT(both.qps > 2.5 && both.qps < 3.1); // 15 запросов за ~5 с работы
+    ASSERT_EQUAL(windowed.GetStats(t0 + std::chrono::seconds(11)).requests, 0u);
+
+    // слот переиспользуется через 10 с; запрос из вытесненного периода не учитывается
+    windowed.RecordRequest(RequestClass::ACTUAL, 1, std::chrono::milliseconds(2), t0 + std::chrono::seconds(10));
+    windowed.RecordRequest(RequestClass::ACTUAL, 1, std::chrono::milliseconds(2), t0);
+    ASSERT_EQUAL(windowed.GetStats(t0 + std::chrono::seconds(10)).requests, 1u);
+
+    const auto t1 = t0 + std::chrono::seconds(30);
+    threads.clear();
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&windowed, t1] {
+            for (int j = 0; j < 1000; ++j) {
+                windowed.RecordRequest(RequestClass::IRRELEVANT, j % 2, std::chrono::microseconds(j), t1);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const auto irrelevant = windowed.GetStats(RequestClass::IRRELEVANT, t1);
+    ASSERT_EQUAL(irrelevant.requests, 8000u);
+    ASSERT_EQUAL(irrelevant.empty_results, 4000u);
+    ASSERT(irrelevant.p50 >= std::chrono::microseconds(499) && irrelevant.p50 <= std::chrono::microseconds(563));
+}
+
+void TestSlowQueryLog() {
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8, -3});
+    search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+
+    const std::string query = "пушистый +кот и -ошейник -слон"s; // слова ссылаются на текст запроса
+    const auto terms = search_server.DescribeQuery(query);
+    ASSERT_EQUAL(terms.size(), 4u);
+    ASSERT_EQUAL(terms[0].word, "кот"sv);
+    ASSERT(terms[0].is_required && !terms[0].is_minus);
+    ASSERT_EQUAL(terms[0].posting_size, 2u);
+    ASSERT_EQUAL(terms[1].word, "пушистый"sv);
+    ASSERT(!terms[1].is_required);
+    ASSERT_EQUAL(terms[3].word, "слон"sv);
+    ASSERT(terms[3].is_minus);
+    ASSERT_EQUAL(terms[3].posting_size, 0u);
+
+    {
+        RequestQueue fast_only(search_server); // порог по умолчанию — 100 мс
+        fast_only.AddFindRequest("кот"s);
+        ASSERT(fast_only.GetSlowQueryLog().Dump().empty());
+    }
+    {
+        // счётчики медленного запроса — от того же выполнения; время по фазам без measure_query_phases не мерится
+        RequestQueue::Options options;
+        options.slow_query_threshold = std::chrono::nanoseconds(1);
+        RequestQueue counted(search_server, options);
+        counted.AddFindRequest("пушистый кот"s);
+        const auto records = counted.GetSlowQueryLog().Dump();
+        ASSERT_EQUAL(records.size(), 1u);
+        ASSERT_EQUAL(records[0].result_count, 2u);
+        ASSERT_EQUAL(records[0].stats.documents_scored, 2u);
+        ASSERT(!records[0].stats.plan_from_cache);
+        ASSERT_EQUAL(records[0].stats.scoring_time.count(), 0);
+        std::ostringstream counted_dump;
+        counted.GetSlowQueryLog().Write(counted_dump);
+        ASSERT(counted_dump.str().find("phases: not measured"s) != std::string::npos);
+
+        options.measure_query_phases = true;
+        RequestQueue timed(search_server, options);
+        timed.AddFindRequest("пушистый кот"s);
+        ASSERT(timed.GetSlowQueryLog().Dump()[0].stats.scoring_time.count() > 0);
+
+        options.slow_query_threshold = std::chrono::nanoseconds::max();
+        RequestQueue disabled(search_server, options);
+        disabled.AddFindRequest("пушистый кот"s);
+        ASSERT(disabled.GetSlowQueryLog().Dump().empty());
+        ASSERT_EQUAL(disabled.GetStats().requests, 1u);
+    }
+
+    RequestQueue::Options options;
+    options.slow_query_threshold = std::chrono::nanoseconds::zero();
+    options.slow_query_capacity = 4;
+    RequestQueue request_queue(search_server, options);
+    for (const std::string& query : {"глаза"s, "пёс"s, "хвост"s, "ошейник"s, "белый"s}) {
+        request_queue.AddFindRequest(query);
+    }
+    request_queue.AddFindRequest("пушистый +кот -ошейник"s, [](int, DocumentStatus, int rating) { return rating > 0; });
+
+    const std::vector<SlowQueryRecord> records = request_queue.GetSlowQueryLog().Dump();
+    ASSERT_EQUAL(records.size(), 4u); // вытеснены два самых старых
+    ASSERT_EQUAL(records[0].raw_query, "хвост"s);
+    const SlowQueryRecord& last = records.back();
+    ASSERT_EQUAL(last.raw_query, "пушистый +кот -ошейник"s);
+    ASSERT_EQUAL(last.result_count, 1u);
+    ASSERT_EQUAL(last.terms.size(), 3u);
+    ASSERT_EQUAL(last.terms[2].word, "ошейник"s);
+    ASSERT_EQUAL(last.terms[2].posting_size, 1u);
+    ASSERT_EQUAL(last.stats.documents_scored, 1u);
+    ASSERT(last.stats.postings_scanned > 0);
+    ASSERT(last.latency >= last.stats.scoring_time);
+
+    std::ostringstream dump;
+    request_queue.GetSlowQueryLog().Write(dump);
+    ASSERT(dump.str().find("query: \"пушистый +кот -ошейник\""s) != std::string::npos);
+    ASSERT(dump.str().find("terms: +кот(2) пушистый(1) -ошейник(1)"s) != std::string::npos);
+
+    // длинный запрос обрезается по размеру слота
+    SlowQueryLog log(8);
+    SlowQueryRecord long_record;
+    long_record.raw_query = std::string(SlowQueryLog::MAX_QUERY_SIZE + 10, 'a');
+    long_record.terms.resize(SlowQueryLog::MAX_TERMS + 1, {std::string(SlowQueryLog::MAX_WORD_SIZE + 1, 'b'), false, false, 7});
+    log.Add(long_record);
+    const auto stored = log.Dump();
+    ASSERT_EQUAL(stored[0].raw_query.size(), SlowQueryLog::MAX_QUERY_SIZE);
+    ASSERT_EQUAL(stored[0].terms.size(), SlowQueryLog::MAX_TERMS);
+    ASSERT_EQUAL(stored[0].terms[0].word.size(), SlowQueryLog::MAX_WORD_SIZE);
+
+    // кириллица обрезается по границе символа: два байта на букву, а вмещается нечётное число байт
+    SlowQueryRecord cyrillic_record;
+    cyrillic_record.raw_query = " "s;
+    for (size_t i = 0; i < SlowQueryLog::MAX_QUERY_SIZE; ++i) {
+        cyrillic_record.raw_query += "ё"s;
+    }
+    cyrillic_record.terms.push_back({" "s + cyrillic_record.raw_query.substr(1, SlowQueryLog::MAX_WORD_SIZE), false, false, 1});
+    log.Add(cyrillic_record);
+    const SlowQueryRecord cyrillic = log.Dump().back();
+    ASSERT_EQUAL(cyrillic.raw_query.size(), SlowQueryLog::MAX_QUERY_SIZE - 1);
+    ASSERT(cyrillic.raw_query.ends_with("ё"s));
+    ASSERT_EQUAL(cyrillic.terms[0].word.size(), SlowQueryLog::MAX_WORD_SIZE - 1);
+    ASSERT(cyrillic.terms[0].word.ends_with("ё"s));
+
+    // одновременные записи и чтения: каждая прочитанная запись целая, потерянные учтены
+    SlowQueryLog shared_log(8);
+    std::atomic<bool> done {false};
+    std::thread reader([&shared_log, &done] {
+        while (!done) {
+            for (const SlowQueryRecord& record : shared_log.Dump()) {
+                ASSERT(record.raw_query.size() == 5 && record.raw_query[0] == record.raw_query[4]);
+                ASSERT_EQUAL(record.result_count, static_cast<size_t>(record.raw_query[0] - 'a'));
+            }
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int i = 0; i < 4; ++i) {
+        writers.emplace_back([&shared_log, i] {
+            SlowQueryRecord record;
+            record.raw_query = std::string(5, static_cast<char>('a' + i));
+            record.result_count = static_cast<size_t>(i);
+            for (int j = 0; j < 2000; ++j) {
+                shared_log.Add(record);
+            }
+        });
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    reader.join();
+    ASSERT_EQUAL(shared_log.GetAddedCount() + shared_log.GetDroppedCount(), 8000u);
+    ASSERT_EQUAL(shared_log.Dump().size(), 8u);
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer() {
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
     RUN_TEST(TestExcludeMinusWordsFromAddedDocumentContent);
     RUN_TEST(TestMatchDocument);
+    RUN_TEST(TestMatchDocumentPolicies);
     RUN_TEST(TestSortingRelevance);
     RUN_TEST(TestComputeRatings);
     RUN_TEST(TestFilterWithPredicate);
+    RUN_TEST(TestDocumentFilter);
+    RUN_TEST(TestRequiredWords);
     RUN_TEST(TestFindStatus);
+    RUN_TEST(TestFindStatusSegments);
     RUN_TEST(TestComputeRelevance);
+    RUN_TEST(TestAdaptiveExecution);
+    RUN_TEST(TestQueryPlan);
+    RUN_TEST(TestPreparedQuery);
+    RUN_TEST(TestScratchArena);
+    RUN_TEST(TestMemoryStats);
+    RUN_TEST(TestTermCounts);
+    RUN_TEST(TestRemoveDocuments);
+    RUN_TEST(TestUpdateDocument);
+    RUN_TEST(TestWriteAheadLog);
+    RUN_TEST(TestProcessQueriesFlat);
+    RUN_TEST(TestDocumentStream);
+    RUN_TEST(TestSearchCursor);
+    RUN_TEST(TestAsyncSearchServer);
+    RUN_TEST(TestInterleavedExecution);
+    RUN_TEST(TestQueryServer);
+    RUN_TEST(TestLoadGenerator);
+    RUN_TEST(TestBenchmarkSuite);
+    RUN_TEST(TestQueryStats);
+    RUN_TEST(TestTracing);
+    RUN_TEST(TestRequestQueueStats);
+    RUN_TEST(TestSlowQueryLog);
     // Не забудьте вызывать остальные тесты здесь
 }
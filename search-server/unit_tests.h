@@ -97,15 +97,66 @@ void TestExcludeMinusWordsFromAddedDocumentContent();
 
 void TestMatchDocument();
 
+void TestMatchDocumentPolicies();
+
 void TestSortingRelevance();
 
 void TestComputeRatings();
 
 void TestFilterWithPredicate();
 
+void TestDocumentFilter();
+
+void TestRequiredWords();
+
 void TestFindStatus();
 
+void TestFindStatusSegments();
+
 void TestComputeRelevance();
+
+void TestAdaptiveExecution();
+
+void TestQueryPlan();
+
+void TestPreparedQuery();
+
+void TestScratchArena();
+
+void TestMemoryStats();
+
+void TestTermCounts();
+
+void TestRemoveDocuments();
+
+void TestUpdateDocument();
+
+void TestWriteAheadLog();
+
+void TestProcessQueriesFlat();
+
+void TestDocumentStream();
+
+void TestSearchCursor();
+
+void TestAsyncSearchServer();
+
+void TestInterleavedExecution();
+
+void TestQueryServer();
+
+void TestLoadGenerator();
+
+void TestBenchmarkSuite();
+
+void TestQueryStats();
+
+void TestTracing();
+
+void TestRequestQueueStats();
+
+void TestSlowQueryLog();
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer();
 
@@ -0,0 +1,190 @@
+#include "write_ahead_log.h"
+#include "binary_io.h"
+
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// заголовок записи: длина тела и его CRC-32
+constexpr size_t RECORD_HEADER_SIZE {2 * sizeof(uint32_t)};
+
+void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("Ошибка записи в журнал");
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+void WriteRatings(std::string& out, const std::vector<int>& ratings) {
+    WriteBinary(out, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        WriteBinary(out, static_cast<int32_t>(rating));
+    }
+}
+
+std::vector<int> ReadRatings(BinaryReader& reader) {
+    std::vector<int> ratings(reader.Read<uint32_t>());
+    for (int& rating : ratings) {
+        rating = reader.Read<int32_t>();
+    }
+    return ratings;
+}
+
+std::string SerializeBody(const WalRecord& record) {
+    std::string body;
+    WriteBinary(body, static_cast<uint8_t>(record.operation));
+    WriteBinary(body, record.lsn);
+    switch (record.operation) {
+    case WalOperation::ADD_DOCUMENT:
+    case WalOperation::UPDATE_DOCUMENT:
+        WriteBinary(body, static_cast<int32_t>(record.document_id));
+        WriteBinary(body, static_cast<uint8_t>(record.status));
+        WriteRatings(body, record.ratings);
+        WriteBinary(body, std::string_view(record.text));
+        break;
+    case WalOperation::REMOVE_DOCUMENTS:
+        WriteRatings(body, record.document_ids); // тот же формат: число и int32
+        break;
+    case WalOperation::UPDATE_ATTRIBUTES:
+        WriteBinary(body, static_cast<int32_t>(record.document_id));
+        WriteBinary(body, static_cast<uint8_t>(record.status));
+        WriteRatings(body, record.ratings);
+        break;
+    }
+    return body;
+}
+
+WalRecord ParseBody(std::string_view body) {
+    BinaryReader reader(body);
+    WalRecord record;
+    record.operation = static_cast<WalOperation>(reader.Read<uint8_t>());
+    record.lsn = reader.Read<uint64_t>();
+    switch (record.operation) {
+    case WalOperation::ADD_DOCUMENT:
+    case WalOperation::UPDATE_DOCUMENT:
+        record.document_id = reader.Read<int32_t>();
+        record.status = static_cast<DocumentStatus>(reader.Read<uint8_t>());
+        record.ratings = ReadRatings(reader);
+        record.text = reader.ReadString();
+        break;
+    case WalOperation::REMOVE_DOCUMENTS:
+        record.document_ids = ReadRatings(reader);
+        break;
+    case WalOperation::UPDATE_ATTRIBUTES:
+        record.document_id = reader.Read<int32_t>();
+        record.status = static_cast<DocumentStatus>(reader.Read<uint8_t>());
+        record.ratings = ReadRatings(reader);
+        break;
+    default:
+        throw std::runtime_error("Неизвестная операция в журнале.");
+    }
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Лишние данные в записи журнала.");
+    }
+    return record;
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(std::string path, uint64_t next_lsn, WalOptions options)
+    : path_(std::move(path))
+    , next_lsn_(next_lsn)
+    , options_(options) {
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        ThrowSystemError("Не удалось открыть журнал " + path_);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    try {
+        Commit();
+    } catch (...) {
+        // деструктор не бросает; незакоммиченные записи и так не считались подтверждёнными
+    }
+    ::close(fd_);
+}
+
+uint64_t WriteAheadLog::Append(WalRecord record) {
+    record.lsn = next_lsn_++;
+    const std::string body = SerializeBody(record);
+    WriteBinary(buffer_, static_cast<uint32_t>(body.size()));
+    WriteBinary(buffer_, Crc32(body));
+    buffer_ += body;
+    if (buffer_.size() >= options_.group_commit_bytes) {
+        Commit();
+    }
+    return record.lsn;
+}
+
+void WriteAheadLog::Commit() {
+    if (buffer_.empty()) {
+        return;
+    }
+    WriteAll(fd_, buffer_);
+    buffer_.clear();
+    if (options_.sync_on_commit && ::fdatasync(fd_) != 0) {
+        ThrowSystemError("Ошибка синхронизации журнала");
+    }
+}
+
+void WriteAheadLog::Reset() {
+    buffer_.clear();
+    if (::ftruncate(fd_, 0) != 0) {
+        ThrowSystemError("Не удалось очистить журнал " + path_);
+    }
+    if (options_.sync_on_commit && ::fdatasync(fd_) != 0) {
+        ThrowSystemError("Ошибка синхронизации журнала");
+    }
+}
+
+uint64_t WriteAheadLog::GetLastLsn() const {
+    return next_lsn_ - 1;
+}
+
+size_t WriteAheadLog::Read(const std::string& path, const std::function<void(const WalRecord&)>& callback) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return 0; // журнала ещё нет
+    }
+    const std::string data {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+    size_t offset = 0;
+    while (data.size() - offset >= RECORD_HEADER_SIZE) {
+        BinaryReader header(std::string_view(data).substr(offset, RECORD_HEADER_SIZE));
+        const uint32_t body_size = header.Read<uint32_t>();
+        const uint32_t crc = header.Read<uint32_t>();
+        if (data.size() - offset - RECORD_HEADER_SIZE < body_size) {
+            break; // запись не дописана
+        }
+        const std::string_view body = std::string_view(data).substr(offset + RECORD_HEADER_SIZE, body_size);
+        if (Crc32(body) != crc) {
+            break;
+        }
+        WalRecord record;
+        try {
+            record = ParseBody(body);
+        } catch (const std::runtime_error&) {
+            break;
+        }
+        callback(record);
+        offset += RECORD_HEADER_SIZE + body_size;
+    }
+    return offset;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "document.h"
+
+enum class WalOperation : uint8_t {
+    ADD_DOCUMENT = 1,
+    REMOVE_DOCUMENTS,
+    UPDATE_DOCUMENT,
+    UPDATE_ATTRIBUTES,
+};
+
+// Одна операция изменения индекса. Поля, не нужные операции, не пишутся в журнал.
+struct WalRecord {
+    uint64_t lsn {0};                // номер записи, растёт на 1
+    WalOperation operation {WalOperation::ADD_DOCUMENT};
+    int document_id {0};             // все операции, кроме REMOVE_DOCUMENTS
+    std::vector<int> document_ids;   // REMOVE_DOCUMENTS
+    DocumentStatus status {DocumentStatus::ACTUAL};
+    std::vector<int> ratings;
+    std::string text;                // ADD_DOCUMENT, UPDATE_DOCUMENT
+};
+
+struct WalOptions {
+    size_t group_commit_bytes {1 << 20}; // при таком объёме накопленные записи коммитятся без явного Commit
+    bool sync_on_commit {true};          // fdatasync при коммите; без него запись переживает только падение процесса
+};
+
+// Журнал упреждающей записи: записи добавляются в конец файла, у каждой — длина и CRC-32.
+// Append копит записи в памяти; Commit пишет всю группу одним write и одним fdatasync,
+// так что стоимость синхронизации делится на все записи группы.
+class WriteAheadLog {
+public:
+    // файл открывается на дозапись (создаётся при отсутствии); next_lsn — номер следующей записи
+    WriteAheadLog(std::string path, uint64_t next_lsn, WalOptions options = {});
+    ~WriteAheadLog(); // коммитит накопленное
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    uint64_t Append(WalRecord record); // возвращает присвоенный lsn
+    void Commit();
+    void Reset(); // после снимка: накопленное отбрасывается, файл очищается
+
+    uint64_t GetLastLsn() const;
+
+    // Читает записи по порядку до конца файла или до первой повреждённой (недописанной при падении).
+    // Возвращает длину корректной части, до которой файл нужно обрезать перед дозаписью.
+    static size_t Read(const std::string& path, const std::function<void(const WalRecord&)>& callback);
+
+private:
+    std::string path_;
+    int fd_ {-1};
+    uint64_t next_lsn_;
+    WalOptions options_;
+    std::string buffer_; // записи, ещё не переданные в файл
+};